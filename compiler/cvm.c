@@ -3,6 +3,7 @@
 #include<sys/types.h>
 #include<stdint.h>
 #include<inttypes.h>
+#include<string.h>
 
 //============================================================
 //=================== OPCODES ================================
@@ -250,6 +251,48 @@
 #define TEST_AND_CLEAR_BIT_OPCODE 249
 #define STORE_WITH_BARRIER_OPCODE 250
 #define STORE_WITH_BARRIER_OPCODE_VAR_OFFSET 251
+#define JUMP_EQ_OPCODE_CONST 189
+#define JUMP_NE_OPCODE_CONST 190
+#define POP_FRAME_GET_REG_OPCODE 252
+#define SET_REG_OPCODE_LOCAL_2 253
+#define GET_REG_OPCODE_2 254
+
+//============================================================
+//==================== DISPATCH MODE =========================
+//============================================================
+
+//By default, compilers that support labels as values use a
+//threaded dispatch loop: every handler decodes the next
+//instruction and jumps directly to its handler through
+//dispatch_table. Compile with -D VM_SWITCH_DISPATCH to use the
+//portable switch-based loop instead.
+#if defined(__GNUC__) && !defined(VM_SWITCH_DISPATCH)
+#define VM_THREADED_DISPATCH
+#endif
+
+#ifdef VM_THREADED_DISPATCH
+
+#define VM_CASE(op) \
+  case op : op##_LABEL :
+
+#define NEXT() \
+  do{ \
+    pc0 = pc; \
+    W1 = PC_INT(); \
+    opcode = W1 & 0xFF; \
+    PROFILE_INS(); \
+    goto *dispatch_table[opcode]; \
+  }while(0)
+
+#else
+
+#define VM_CASE(op) \
+  case op :
+
+#define NEXT() \
+  continue
+
+#endif
 
 //============================================================
 //===================== READ MACROS ==========================
@@ -311,11 +354,11 @@
 #define F_JUMP(condition) \
   if(condition){ \
     pc = pc0 + (n1 * 4); \
-    continue; \
+    NEXT(); \
   } \
   else{ \
     pc = pc0 + (n2 * 4); \
-    continue; \
+    NEXT(); \
   }
 
 #define DECODE_TGTS() \
@@ -438,6 +481,7 @@ typedef struct{
   //Interpreted Mode Tables
   char* instructions;          //(Permanent State)
   void** trie_table;           //(Permanent State)
+  uint64_t num_functions;      //(Permanent State)
 } VMState;
 
 typedef struct{
@@ -529,11 +573,13 @@ void call_print_stack_trace (VMState* vms, uint64_t stack);
 void* call_collect_stack_trace (VMState* vms, uint64_t stack);
 void c_trampoline (void* fptr, void* argbuffer, void* retbuffer);
 uint64_t lowest_zero_bit_count (uint64_t x);
+int64_t current_time_us (void);
 
 //============================================================
 //=================== Forward Declarations ===================
 //============================================================
 int read_dispatch_table (VMState* vms, int format);
+int read_cached_dispatch_table (VMState* vms, uint32_t site, int format);
 
 //============================================================
 //==================== Write Barrier =========================
@@ -546,6 +592,445 @@ static inline void barriered_store (const VMState* vms, uint64_t* address, uint6
   set_mark(address, vms->heap.bitset_base);
 }
 
+//============================================================
+//===================== VM Profiler ==========================
+//============================================================
+
+//When the STANZA_VM_PROFILE environment variable is set to a
+//filename, vmloop counts every executed instruction and times
+//the garbage collector and calls to C. When the process exits,
+//a report is written to that file, and the instruction counts
+//are written to the same filename with a ".folded" suffix as
+//"function;opcode count" lines for flamegraph tools.
+
+typedef struct{
+  char* filename;
+  uint64_t opcode_counts[256];
+  uint64_t* pc_counts;         //Indexed by instruction word
+  uint64_t pc_counts_length;
+  int depth;                   //Number of active vmloop calls
+  int64_t vm_time;
+  int64_t gc_time;
+  int64_t c_time;
+  uint64_t num_gcs;
+  uint64_t num_c_calls;
+  //Machine state of the most recent vmloop call
+  VMState* vms;
+} VMProfile;
+
+static const char* OPCODE_NAMES[256] = {
+  [SET_OPCODE_LOCAL] = "SET_OPCODE_LOCAL",
+  [SET_OPCODE_UNSIGNED] = "SET_OPCODE_UNSIGNED",
+  [SET_OPCODE_SIGNED] = "SET_OPCODE_SIGNED",
+  [SET_OPCODE_CODE] = "SET_OPCODE_CODE",
+  [SET_OPCODE_GLOBAL] = "SET_OPCODE_GLOBAL",
+  [SET_OPCODE_DATA] = "SET_OPCODE_DATA",
+  [SET_OPCODE_CONST] = "SET_OPCODE_CONST",
+  [SET_OPCODE_WIDE] = "SET_OPCODE_WIDE",
+  [SET_REG_OPCODE_LOCAL] = "SET_REG_OPCODE_LOCAL",
+  [SET_REG_OPCODE_UNSIGNED] = "SET_REG_OPCODE_UNSIGNED",
+  [SET_REG_OPCODE_SIGNED] = "SET_REG_OPCODE_SIGNED",
+  [SET_REG_OPCODE_CODE] = "SET_REG_OPCODE_CODE",
+  [SET_REG_OPCODE_GLOBAL] = "SET_REG_OPCODE_GLOBAL",
+  [SET_REG_OPCODE_DATA] = "SET_REG_OPCODE_DATA",
+  [SET_REG_OPCODE_CONST] = "SET_REG_OPCODE_CONST",
+  [SET_REG_OPCODE_WIDE] = "SET_REG_OPCODE_WIDE",
+  [GET_REG_OPCODE] = "GET_REG_OPCODE",
+  [CALL_OPCODE_LOCAL] = "CALL_OPCODE_LOCAL",
+  [CALL_OPCODE_CODE] = "CALL_OPCODE_CODE",
+  [CALL_CLOSURE_OPCODE] = "CALL_CLOSURE_OPCODE",
+  [TCALL_OPCODE_LOCAL] = "TCALL_OPCODE_LOCAL",
+  [TCALL_OPCODE_CODE] = "TCALL_OPCODE_CODE",
+  [TCALL_CLOSURE_OPCODE] = "TCALL_CLOSURE_OPCODE",
+  [CALLC_OPCODE_LOCAL] = "CALLC_OPCODE_LOCAL",
+  [CALLC_OPCODE_WIDE] = "CALLC_OPCODE_WIDE",
+  [POP_FRAME_OPCODE] = "POP_FRAME_OPCODE",
+  [LIVE_OPCODE] = "LIVE_OPCODE",
+  [YIELD_OPCODE] = "YIELD_OPCODE",
+  [RETURN_OPCODE] = "RETURN_OPCODE",
+  [DUMP_OPCODE] = "DUMP_OPCODE",
+  [INT_ADD_OPCODE] = "INT_ADD_OPCODE",
+  [INT_SUB_OPCODE] = "INT_SUB_OPCODE",
+  [INT_MUL_OPCODE] = "INT_MUL_OPCODE",
+  [INT_DIV_OPCODE] = "INT_DIV_OPCODE",
+  [INT_MOD_OPCODE] = "INT_MOD_OPCODE",
+  [INT_AND_OPCODE] = "INT_AND_OPCODE",
+  [INT_OR_OPCODE] = "INT_OR_OPCODE",
+  [INT_XOR_OPCODE] = "INT_XOR_OPCODE",
+  [INT_SHL_OPCODE] = "INT_SHL_OPCODE",
+  [INT_SHR_OPCODE] = "INT_SHR_OPCODE",
+  [INT_ASHR_OPCODE] = "INT_ASHR_OPCODE",
+  [INT_LT_OPCODE] = "INT_LT_OPCODE",
+  [INT_GT_OPCODE] = "INT_GT_OPCODE",
+  [INT_LE_OPCODE] = "INT_LE_OPCODE",
+  [INT_GE_OPCODE] = "INT_GE_OPCODE",
+  [REF_EQ_OPCODE] = "REF_EQ_OPCODE",
+  [EQ_OPCODE_REF] = "EQ_OPCODE_REF",
+  [EQ_OPCODE_BYTE] = "EQ_OPCODE_BYTE",
+  [EQ_OPCODE_INT] = "EQ_OPCODE_INT",
+  [EQ_OPCODE_LONG] = "EQ_OPCODE_LONG",
+  [EQ_OPCODE_FLOAT] = "EQ_OPCODE_FLOAT",
+  [EQ_OPCODE_DOUBLE] = "EQ_OPCODE_DOUBLE",
+  [REF_NE_OPCODE] = "REF_NE_OPCODE",
+  [NE_OPCODE_REF] = "NE_OPCODE_REF",
+  [NE_OPCODE_BYTE] = "NE_OPCODE_BYTE",
+  [NE_OPCODE_INT] = "NE_OPCODE_INT",
+  [NE_OPCODE_LONG] = "NE_OPCODE_LONG",
+  [NE_OPCODE_FLOAT] = "NE_OPCODE_FLOAT",
+  [NE_OPCODE_DOUBLE] = "NE_OPCODE_DOUBLE",
+  [ADD_OPCODE_BYTE] = "ADD_OPCODE_BYTE",
+  [ADD_OPCODE_INT] = "ADD_OPCODE_INT",
+  [ADD_OPCODE_LONG] = "ADD_OPCODE_LONG",
+  [ADD_OPCODE_FLOAT] = "ADD_OPCODE_FLOAT",
+  [ADD_OPCODE_DOUBLE] = "ADD_OPCODE_DOUBLE",
+  [SUB_OPCODE_BYTE] = "SUB_OPCODE_BYTE",
+  [SUB_OPCODE_INT] = "SUB_OPCODE_INT",
+  [SUB_OPCODE_LONG] = "SUB_OPCODE_LONG",
+  [SUB_OPCODE_FLOAT] = "SUB_OPCODE_FLOAT",
+  [SUB_OPCODE_DOUBLE] = "SUB_OPCODE_DOUBLE",
+  [MUL_OPCODE_BYTE] = "MUL_OPCODE_BYTE",
+  [MUL_OPCODE_INT] = "MUL_OPCODE_INT",
+  [MUL_OPCODE_LONG] = "MUL_OPCODE_LONG",
+  [MUL_OPCODE_FLOAT] = "MUL_OPCODE_FLOAT",
+  [MUL_OPCODE_DOUBLE] = "MUL_OPCODE_DOUBLE",
+  [DIV_OPCODE_BYTE] = "DIV_OPCODE_BYTE",
+  [DIV_OPCODE_INT] = "DIV_OPCODE_INT",
+  [DIV_OPCODE_LONG] = "DIV_OPCODE_LONG",
+  [DIV_OPCODE_FLOAT] = "DIV_OPCODE_FLOAT",
+  [DIV_OPCODE_DOUBLE] = "DIV_OPCODE_DOUBLE",
+  [MOD_OPCODE_BYTE] = "MOD_OPCODE_BYTE",
+  [MOD_OPCODE_INT] = "MOD_OPCODE_INT",
+  [MOD_OPCODE_LONG] = "MOD_OPCODE_LONG",
+  [AND_OPCODE_BYTE] = "AND_OPCODE_BYTE",
+  [AND_OPCODE_INT] = "AND_OPCODE_INT",
+  [AND_OPCODE_LONG] = "AND_OPCODE_LONG",
+  [OR_OPCODE_BYTE] = "OR_OPCODE_BYTE",
+  [OR_OPCODE_INT] = "OR_OPCODE_INT",
+  [OR_OPCODE_LONG] = "OR_OPCODE_LONG",
+  [XOR_OPCODE_BYTE] = "XOR_OPCODE_BYTE",
+  [XOR_OPCODE_INT] = "XOR_OPCODE_INT",
+  [XOR_OPCODE_LONG] = "XOR_OPCODE_LONG",
+  [SHL_OPCODE_BYTE] = "SHL_OPCODE_BYTE",
+  [SHL_OPCODE_INT] = "SHL_OPCODE_INT",
+  [SHL_OPCODE_LONG] = "SHL_OPCODE_LONG",
+  [SHR_OPCODE_BYTE] = "SHR_OPCODE_BYTE",
+  [SHR_OPCODE_INT] = "SHR_OPCODE_INT",
+  [SHR_OPCODE_LONG] = "SHR_OPCODE_LONG",
+  [ASHR_OPCODE_INT] = "ASHR_OPCODE_INT",
+  [ASHR_OPCODE_LONG] = "ASHR_OPCODE_LONG",
+  [LT_OPCODE_INT] = "LT_OPCODE_INT",
+  [LT_OPCODE_LONG] = "LT_OPCODE_LONG",
+  [LT_OPCODE_FLOAT] = "LT_OPCODE_FLOAT",
+  [LT_OPCODE_DOUBLE] = "LT_OPCODE_DOUBLE",
+  [GT_OPCODE_INT] = "GT_OPCODE_INT",
+  [GT_OPCODE_LONG] = "GT_OPCODE_LONG",
+  [GT_OPCODE_FLOAT] = "GT_OPCODE_FLOAT",
+  [GT_OPCODE_DOUBLE] = "GT_OPCODE_DOUBLE",
+  [LE_OPCODE_INT] = "LE_OPCODE_INT",
+  [LE_OPCODE_LONG] = "LE_OPCODE_LONG",
+  [LE_OPCODE_FLOAT] = "LE_OPCODE_FLOAT",
+  [LE_OPCODE_DOUBLE] = "LE_OPCODE_DOUBLE",
+  [GE_OPCODE_INT] = "GE_OPCODE_INT",
+  [GE_OPCODE_LONG] = "GE_OPCODE_LONG",
+  [GE_OPCODE_FLOAT] = "GE_OPCODE_FLOAT",
+  [GE_OPCODE_DOUBLE] = "GE_OPCODE_DOUBLE",
+  [ULE_OPCODE_BYTE] = "ULE_OPCODE_BYTE",
+  [ULE_OPCODE_INT] = "ULE_OPCODE_INT",
+  [ULE_OPCODE_LONG] = "ULE_OPCODE_LONG",
+  [ULT_OPCODE_BYTE] = "ULT_OPCODE_BYTE",
+  [ULT_OPCODE_INT] = "ULT_OPCODE_INT",
+  [ULT_OPCODE_LONG] = "ULT_OPCODE_LONG",
+  [UGT_OPCODE_BYTE] = "UGT_OPCODE_BYTE",
+  [UGT_OPCODE_INT] = "UGT_OPCODE_INT",
+  [UGT_OPCODE_LONG] = "UGT_OPCODE_LONG",
+  [UGE_OPCODE_BYTE] = "UGE_OPCODE_BYTE",
+  [UGE_OPCODE_INT] = "UGE_OPCODE_INT",
+  [UGE_OPCODE_LONG] = "UGE_OPCODE_LONG",
+  [INT_NOT_OPCODE] = "INT_NOT_OPCODE",
+  [INT_NEG_OPCODE] = "INT_NEG_OPCODE",
+  [NOT_OPCODE_BYTE] = "NOT_OPCODE_BYTE",
+  [NOT_OPCODE_INT] = "NOT_OPCODE_INT",
+  [NOT_OPCODE_LONG] = "NOT_OPCODE_LONG",
+  [NEG_OPCODE_INT] = "NEG_OPCODE_INT",
+  [NEG_OPCODE_LONG] = "NEG_OPCODE_LONG",
+  [NEG_OPCODE_FLOAT] = "NEG_OPCODE_FLOAT",
+  [NEG_OPCODE_DOUBLE] = "NEG_OPCODE_DOUBLE",
+  [DEREF_OPCODE] = "DEREF_OPCODE",
+  [TYPEOF_OPCODE] = "TYPEOF_OPCODE",
+  [JUMP_SET_OPCODE] = "JUMP_SET_OPCODE",
+  [JUMP_TAGBITS_OPCODE] = "JUMP_TAGBITS_OPCODE",
+  [JUMP_TAGWORD_OPCODE] = "JUMP_TAGWORD_OPCODE",
+  [GOTO_OPCODE] = "GOTO_OPCODE",
+  [CONV_OPCODE_BYTE_FLOAT] = "CONV_OPCODE_BYTE_FLOAT",
+  [CONV_OPCODE_BYTE_DOUBLE] = "CONV_OPCODE_BYTE_DOUBLE",
+  [CONV_OPCODE_INT_BYTE] = "CONV_OPCODE_INT_BYTE",
+  [CONV_OPCODE_INT_FLOAT] = "CONV_OPCODE_INT_FLOAT",
+  [CONV_OPCODE_INT_DOUBLE] = "CONV_OPCODE_INT_DOUBLE",
+  [CONV_OPCODE_LONG_BYTE] = "CONV_OPCODE_LONG_BYTE",
+  [CONV_OPCODE_LONG_INT] = "CONV_OPCODE_LONG_INT",
+  [CONV_OPCODE_LONG_FLOAT] = "CONV_OPCODE_LONG_FLOAT",
+  [CONV_OPCODE_LONG_DOUBLE] = "CONV_OPCODE_LONG_DOUBLE",
+  [CONV_OPCODE_FLOAT_BYTE] = "CONV_OPCODE_FLOAT_BYTE",
+  [CONV_OPCODE_FLOAT_INT] = "CONV_OPCODE_FLOAT_INT",
+  [CONV_OPCODE_FLOAT_LONG] = "CONV_OPCODE_FLOAT_LONG",
+  [CONV_OPCODE_FLOAT_DOUBLE] = "CONV_OPCODE_FLOAT_DOUBLE",
+  [CONV_OPCODE_DOUBLE_BYTE] = "CONV_OPCODE_DOUBLE_BYTE",
+  [CONV_OPCODE_DOUBLE_INT] = "CONV_OPCODE_DOUBLE_INT",
+  [CONV_OPCODE_DOUBLE_LONG] = "CONV_OPCODE_DOUBLE_LONG",
+  [CONV_OPCODE_DOUBLE_FLOAT] = "CONV_OPCODE_DOUBLE_FLOAT",
+  [DETAG_OPCODE] = "DETAG_OPCODE",
+  [TAG_OPCODE_BYTE] = "TAG_OPCODE_BYTE",
+  [TAG_OPCODE_CHAR] = "TAG_OPCODE_CHAR",
+  [TAG_OPCODE_INT] = "TAG_OPCODE_INT",
+  [TAG_OPCODE_FLOAT] = "TAG_OPCODE_FLOAT",
+  [STORE_OPCODE_1] = "STORE_OPCODE_1",
+  [STORE_OPCODE_4] = "STORE_OPCODE_4",
+  [STORE_OPCODE_8] = "STORE_OPCODE_8",
+  [STORE_OPCODE_1_VAR_OFFSET] = "STORE_OPCODE_1_VAR_OFFSET",
+  [STORE_OPCODE_4_VAR_OFFSET] = "STORE_OPCODE_4_VAR_OFFSET",
+  [STORE_OPCODE_8_VAR_OFFSET] = "STORE_OPCODE_8_VAR_OFFSET",
+  [LOAD_OPCODE_1] = "LOAD_OPCODE_1",
+  [LOAD_OPCODE_4] = "LOAD_OPCODE_4",
+  [LOAD_OPCODE_8] = "LOAD_OPCODE_8",
+  [LOAD_OPCODE_1_VAR_OFFSET] = "LOAD_OPCODE_1_VAR_OFFSET",
+  [LOAD_OPCODE_4_VAR_OFFSET] = "LOAD_OPCODE_4_VAR_OFFSET",
+  [LOAD_OPCODE_8_VAR_OFFSET] = "LOAD_OPCODE_8_VAR_OFFSET",
+  [RESERVE_OPCODE_LOCAL] = "RESERVE_OPCODE_LOCAL",
+  [RESERVE_OPCODE_CONST] = "RESERVE_OPCODE_CONST",
+  [ENTER_STACK_OPCODE] = "ENTER_STACK_OPCODE",
+  [ALLOC_OPCODE_CONST] = "ALLOC_OPCODE_CONST",
+  [ALLOC_OPCODE_LOCAL] = "ALLOC_OPCODE_LOCAL",
+  [GC_OPCODE] = "GC_OPCODE",
+  [PRINT_STACK_TRACE_OPCODE] = "PRINT_STACK_TRACE_OPCODE",
+  [COLLECT_STACK_TRACE_OPCODE] = "COLLECT_STACK_TRACE_OPCODE",
+  [FLUSH_VM_OPCODE] = "FLUSH_VM_OPCODE",
+  [C_RSP_OPCODE] = "C_RSP_OPCODE",
+  [JUMP_INT_LT_OPCODE] = "JUMP_INT_LT_OPCODE",
+  [JUMP_INT_GT_OPCODE] = "JUMP_INT_GT_OPCODE",
+  [JUMP_INT_LE_OPCODE] = "JUMP_INT_LE_OPCODE",
+  [JUMP_INT_GE_OPCODE] = "JUMP_INT_GE_OPCODE",
+  [JUMP_EQ_OPCODE_REF] = "JUMP_EQ_OPCODE_REF",
+  [JUMP_EQ_OPCODE_BYTE] = "JUMP_EQ_OPCODE_BYTE",
+  [JUMP_EQ_OPCODE_INT] = "JUMP_EQ_OPCODE_INT",
+  [JUMP_EQ_OPCODE_LONG] = "JUMP_EQ_OPCODE_LONG",
+  [JUMP_EQ_OPCODE_FLOAT] = "JUMP_EQ_OPCODE_FLOAT",
+  [JUMP_EQ_OPCODE_DOUBLE] = "JUMP_EQ_OPCODE_DOUBLE",
+  [JUMP_NE_OPCODE_REF] = "JUMP_NE_OPCODE_REF",
+  [JUMP_NE_OPCODE_BYTE] = "JUMP_NE_OPCODE_BYTE",
+  [JUMP_NE_OPCODE_INT] = "JUMP_NE_OPCODE_INT",
+  [JUMP_NE_OPCODE_LONG] = "JUMP_NE_OPCODE_LONG",
+  [JUMP_NE_OPCODE_FLOAT] = "JUMP_NE_OPCODE_FLOAT",
+  [JUMP_NE_OPCODE_DOUBLE] = "JUMP_NE_OPCODE_DOUBLE",
+  [JUMP_LT_OPCODE_INT] = "JUMP_LT_OPCODE_INT",
+  [JUMP_LT_OPCODE_LONG] = "JUMP_LT_OPCODE_LONG",
+  [JUMP_LT_OPCODE_FLOAT] = "JUMP_LT_OPCODE_FLOAT",
+  [JUMP_LT_OPCODE_DOUBLE] = "JUMP_LT_OPCODE_DOUBLE",
+  [JUMP_GT_OPCODE_INT] = "JUMP_GT_OPCODE_INT",
+  [JUMP_GT_OPCODE_LONG] = "JUMP_GT_OPCODE_LONG",
+  [JUMP_GT_OPCODE_FLOAT] = "JUMP_GT_OPCODE_FLOAT",
+  [JUMP_GT_OPCODE_DOUBLE] = "JUMP_GT_OPCODE_DOUBLE",
+  [JUMP_LE_OPCODE_INT] = "JUMP_LE_OPCODE_INT",
+  [JUMP_LE_OPCODE_LONG] = "JUMP_LE_OPCODE_LONG",
+  [JUMP_LE_OPCODE_FLOAT] = "JUMP_LE_OPCODE_FLOAT",
+  [JUMP_LE_OPCODE_DOUBLE] = "JUMP_LE_OPCODE_DOUBLE",
+  [JUMP_GE_OPCODE_INT] = "JUMP_GE_OPCODE_INT",
+  [JUMP_GE_OPCODE_LONG] = "JUMP_GE_OPCODE_LONG",
+  [JUMP_GE_OPCODE_FLOAT] = "JUMP_GE_OPCODE_FLOAT",
+  [JUMP_GE_OPCODE_DOUBLE] = "JUMP_GE_OPCODE_DOUBLE",
+  [JUMP_ULE_OPCODE_BYTE] = "JUMP_ULE_OPCODE_BYTE",
+  [JUMP_ULE_OPCODE_INT] = "JUMP_ULE_OPCODE_INT",
+  [JUMP_ULE_OPCODE_LONG] = "JUMP_ULE_OPCODE_LONG",
+  [JUMP_ULT_OPCODE_BYTE] = "JUMP_ULT_OPCODE_BYTE",
+  [JUMP_ULT_OPCODE_INT] = "JUMP_ULT_OPCODE_INT",
+  [JUMP_ULT_OPCODE_LONG] = "JUMP_ULT_OPCODE_LONG",
+  [JUMP_UGT_OPCODE_BYTE] = "JUMP_UGT_OPCODE_BYTE",
+  [JUMP_UGT_OPCODE_INT] = "JUMP_UGT_OPCODE_INT",
+  [JUMP_UGT_OPCODE_LONG] = "JUMP_UGT_OPCODE_LONG",
+  [JUMP_UGE_OPCODE_BYTE] = "JUMP_UGE_OPCODE_BYTE",
+  [JUMP_UGE_OPCODE_INT] = "JUMP_UGE_OPCODE_INT",
+  [JUMP_UGE_OPCODE_LONG] = "JUMP_UGE_OPCODE_LONG",
+  [DISPATCH_OPCODE] = "DISPATCH_OPCODE",
+  [DISPATCH_METHOD_OPCODE] = "DISPATCH_METHOD_OPCODE",
+  [JUMP_REG_OPCODE] = "JUMP_REG_OPCODE",
+  [FNENTRY_OPCODE] = "FNENTRY_OPCODE",
+  [LOWEST_ZERO_BIT_COUNT_OPCODE_LONG] = "LOWEST_ZERO_BIT_COUNT_OPCODE_LONG",
+  [TEST_BIT_OPCODE] = "TEST_BIT_OPCODE",
+  [SET_BIT_OPCODE] = "SET_BIT_OPCODE",
+  [CLEAR_BIT_OPCODE] = "CLEAR_BIT_OPCODE",
+  [TEST_AND_SET_BIT_OPCODE] = "TEST_AND_SET_BIT_OPCODE",
+  [TEST_AND_CLEAR_BIT_OPCODE] = "TEST_AND_CLEAR_BIT_OPCODE",
+  [STORE_WITH_BARRIER_OPCODE] = "STORE_WITH_BARRIER_OPCODE",
+  [STORE_WITH_BARRIER_OPCODE_VAR_OFFSET] = "STORE_WITH_BARRIER_OPCODE_VAR_OFFSET",
+  [JUMP_EQ_OPCODE_CONST] = "JUMP_EQ_OPCODE_CONST",
+  [JUMP_NE_OPCODE_CONST] = "JUMP_NE_OPCODE_CONST",
+  [POP_FRAME_GET_REG_OPCODE] = "POP_FRAME_GET_REG_OPCODE",
+  [SET_REG_OPCODE_LOCAL_2] = "SET_REG_OPCODE_LOCAL_2",
+  [GET_REG_OPCODE_2] = "GET_REG_OPCODE_2",
+};
+
+static VMProfile* vm_profile = NULL;
+static int vm_profile_initialized = 0;
+
+static void record_instruction (VMProfile* p, uint64_t pos, int opcode){
+  p->opcode_counts[opcode]++;
+  uint64_t i = pos >> 2;
+  if(i >= p->pc_counts_length){
+    uint64_t n = p->pc_counts_length * 2;
+    if(n <= i) n = i + 1024;
+    p->pc_counts = (uint64_t*)realloc(p->pc_counts, n * sizeof(uint64_t));
+    memset(p->pc_counts + p->pc_counts_length, 0, (n - p->pc_counts_length) * sizeof(uint64_t));
+    p->pc_counts_length = n;
+  }
+  p->pc_counts[i]++;
+}
+
+typedef struct{
+  int64_t key;
+  uint64_t value;
+} ProfileEntry;
+
+static int compare_offsets (const void* a, const void* b){
+  int64_t x = ((const ProfileEntry*)a)->key;
+  int64_t y = ((const ProfileEntry*)b)->key;
+  return (x > y) - (x < y);
+}
+
+static int compare_counts_descending (const void* a, const void* b){
+  uint64_t x = ((const ProfileEntry*)a)->value;
+  uint64_t y = ((const ProfileEntry*)b)->value;
+  return (x < y) - (x > y);
+}
+
+static double percent (uint64_t x, uint64_t total){
+  return total == 0 ? 0.0 : 100.0 * (double)x / (double)total;
+}
+
+static void write_vm_profile (void){
+  VMProfile* p = vm_profile;
+  if(p->vms == NULL) return;
+  char* instructions = p->vms->instructions;
+  uint32_t* code_offsets = p->vms->code_offsets;
+  uint64_t num_code_offsets = p->vms->num_functions;
+  FILE* out = fopen(p->filename, "w");
+  if(out == NULL){
+    fprintf(stderr, "Could not open VM profile file %s.\n", p->filename);
+    return;
+  }
+
+  //Summary
+  uint64_t total = 0;
+  for(int i=0; i<256; i++) total += p->opcode_counts[i];
+  int64_t interp_time = p->vm_time - p->gc_time - p->c_time;
+  fprintf(out, "Instructions executed: %" PRIu64 "\n", total);
+  fprintf(out, "Time in VM: %.3f ms\n", p->vm_time / 1000.0);
+  fprintf(out, "  Interpreter: %.3f ms\n", interp_time / 1000.0);
+  fprintf(out, "  Garbage collector: %.3f ms (%" PRIu64 " calls)\n", p->gc_time / 1000.0, p->num_gcs);
+  fprintf(out, "  C calls: %.3f ms (%" PRIu64 " calls)\n", p->c_time / 1000.0, p->num_c_calls);
+
+  //Opcodes, most frequent first
+  ProfileEntry opcodes[256];
+  for(int i=0; i<256; i++){
+    opcodes[i].key = i;
+    opcodes[i].value = p->opcode_counts[i];
+  }
+  qsort(opcodes, 256, sizeof(ProfileEntry), compare_counts_descending);
+  fprintf(out, "\nOpcodes:\n");
+  for(int i=0; i<256 && opcodes[i].value > 0; i++)
+    fprintf(out, "  %-40s %14" PRIu64 " %7.2f%%\n", OPCODE_NAMES[opcodes[i].key],
+            opcodes[i].value, percent(opcodes[i].value, total));
+
+  //Function start positions, sorted by position.
+  //Functions that are not loaded have a negative offset.
+  uint64_t num_functions = 0;
+  ProfileEntry* starts = (ProfileEntry*)malloc((num_code_offsets + 1) * sizeof(ProfileEntry));
+  for(uint64_t fid=0; fid<num_code_offsets; fid++){
+    int32_t offset = (int32_t)code_offsets[fid];
+    if(offset >= 0){
+      starts[num_functions].key = offset;
+      starts[num_functions].value = fid;
+      num_functions++;
+    }
+  }
+  qsort(starts, num_functions, sizeof(ProfileEntry), compare_offsets);
+
+  //Attribute each instruction to the function that contains it.
+  //Instructions are visited in order, so each function is a contiguous run.
+  char folded_filename[strlen(p->filename) + 8];
+  sprintf(folded_filename, "%s.folded", p->filename);
+  FILE* folded = fopen(folded_filename, "w");
+  ProfileEntry* functions = (ProfileEntry*)malloc((num_functions + 1) * sizeof(ProfileEntry));
+  uint64_t function_opcode_counts[256];
+  int64_t f = -1;
+  for(uint64_t i=0; i<=p->pc_counts_length; i++){
+    int64_t next_f = f;
+    if(i < p->pc_counts_length){
+      while(next_f + 1 < (int64_t)num_functions && starts[next_f + 1].key <= (int64_t)i)
+        next_f++;
+    }
+    if(next_f != f || i == p->pc_counts_length){
+      //Flush counts of previous function
+      if(f >= 0 && functions[f].value > 0 && folded != NULL){
+        for(int op=0; op<256; op++)
+          if(function_opcode_counts[op] > 0)
+            fprintf(folded, "fn%" PRIu64 ";%s %" PRIu64 "\n", starts[f].value,
+                    OPCODE_NAMES[op], function_opcode_counts[op]);
+      }
+      if(i == p->pc_counts_length) break;
+      f = next_f;
+      functions[f].key = starts[f].value;
+      functions[f].value = 0;
+      memset(function_opcode_counts, 0, sizeof(function_opcode_counts));
+    }
+    uint64_t count = p->pc_counts[i];
+    if(count > 0 && f >= 0){
+      int opcode = (uint8_t)instructions[i * 4];
+      functions[f].value += count;
+      function_opcode_counts[opcode] += count;
+    }
+  }
+  if(folded != NULL) fclose(folded);
+
+  //Functions, most instructions first
+  uint64_t num_reported = f + 1;
+  qsort(functions, num_reported, sizeof(ProfileEntry), compare_counts_descending);
+  fprintf(out, "\nFunctions:\n");
+  for(uint64_t i=0; i<num_reported && functions[i].value > 0; i++)
+    fprintf(out, "  fn%-37" PRId64 " %14" PRIu64 " %7.2f%%\n", functions[i].key,
+            functions[i].value, percent(functions[i].value, total));
+
+  free(starts);
+  free(functions);
+  fclose(out);
+}
+
+//Returns the active profile, or NULL if profiling is disabled.
+static VMProfile* vm_profile_for (VMState* vms){
+  if(!vm_profile_initialized){
+    vm_profile_initialized = 1;
+    char* filename = getenv("STANZA_VM_PROFILE");
+    if(filename != NULL && filename[0] != 0){
+      vm_profile = (VMProfile*)calloc(1, sizeof(VMProfile));
+      vm_profile->filename = filename;
+      atexit(write_vm_profile);
+    }
+  }
+  if(vm_profile != NULL)
+    vm_profile->vms = vms;
+  return vm_profile;
+}
+
+#define PROFILE_INS() \
+  if(profile) record_instruction(profile, pc0 - instructions, opcode);
+
+#define PROFILE_START() \
+  int64_t profile_t0 = profile ? current_time_us() : 0;
+
+#define PROFILE_END(time, num) \
+  if(profile){ \
+    profile->time += current_time_us() - profile_t0; \
+    profile->num++; \
+  }
+
 //============================================================
 //===================== MAIN LOOP ============================
 //============================================================
@@ -597,15 +1082,276 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
   char* stack_limit = (char*)(stk->frames) + stk->size;
   char* pc = instructions + stk->pc;
 
-  //Timing
-  //uint64_t* timings = (uint64_t*)malloc(255 * sizeof(uint64_t));
-  //for(int i=0; i<255; i++) timings[i] = 0;
-  //int last_opcode = -1;
-  //uint64_t last_time;
+  //Profiling
+  //Only the outermost vmloop call is timed, as nested calls
+  //are made from within C calls.
+  VMProfile* profile = vm_profile_for(vms);
+  int64_t profile_vm_t0 = 0;
+  if(profile && profile->depth++ == 0)
+    profile_vm_t0 = current_time_us();
 
   //Debug
   //init_iprint();
 
+  //Decoder State
+  char* pc0;
+  uint32_t W1;
+  int opcode;
+
+#ifdef VM_THREADED_DISPATCH
+  //Handler address for each opcode
+  static void* dispatch_table[256] = {
+    [0 ... 255] = &&INVALID_OPCODE_LABEL,
+    [SET_OPCODE_LOCAL] = &&SET_OPCODE_LOCAL_LABEL,
+    [SET_OPCODE_UNSIGNED] = &&SET_OPCODE_UNSIGNED_LABEL,
+    [SET_OPCODE_SIGNED] = &&SET_OPCODE_SIGNED_LABEL,
+    [SET_OPCODE_CODE] = &&SET_OPCODE_CODE_LABEL,
+    [SET_OPCODE_GLOBAL] = &&SET_OPCODE_GLOBAL_LABEL,
+    [SET_OPCODE_DATA] = &&SET_OPCODE_DATA_LABEL,
+    [SET_OPCODE_CONST] = &&SET_OPCODE_CONST_LABEL,
+    [SET_OPCODE_WIDE] = &&SET_OPCODE_WIDE_LABEL,
+    [SET_REG_OPCODE_LOCAL] = &&SET_REG_OPCODE_LOCAL_LABEL,
+    [SET_REG_OPCODE_UNSIGNED] = &&SET_REG_OPCODE_UNSIGNED_LABEL,
+    [SET_REG_OPCODE_SIGNED] = &&SET_REG_OPCODE_SIGNED_LABEL,
+    [SET_REG_OPCODE_CODE] = &&SET_REG_OPCODE_CODE_LABEL,
+    [SET_REG_OPCODE_GLOBAL] = &&SET_REG_OPCODE_GLOBAL_LABEL,
+    [SET_REG_OPCODE_DATA] = &&SET_REG_OPCODE_DATA_LABEL,
+    [SET_REG_OPCODE_CONST] = &&SET_REG_OPCODE_CONST_LABEL,
+    [SET_REG_OPCODE_WIDE] = &&SET_REG_OPCODE_WIDE_LABEL,
+    [GET_REG_OPCODE] = &&GET_REG_OPCODE_LABEL,
+    [CALL_OPCODE_LOCAL] = &&CALL_OPCODE_LOCAL_LABEL,
+    [CALL_OPCODE_CODE] = &&CALL_OPCODE_CODE_LABEL,
+    [CALL_CLOSURE_OPCODE] = &&CALL_CLOSURE_OPCODE_LABEL,
+    [TCALL_OPCODE_LOCAL] = &&TCALL_OPCODE_LOCAL_LABEL,
+    [TCALL_OPCODE_CODE] = &&TCALL_OPCODE_CODE_LABEL,
+    [TCALL_CLOSURE_OPCODE] = &&TCALL_CLOSURE_OPCODE_LABEL,
+    [CALLC_OPCODE_LOCAL] = &&CALLC_OPCODE_LOCAL_LABEL,
+    [CALLC_OPCODE_WIDE] = &&CALLC_OPCODE_WIDE_LABEL,
+    [POP_FRAME_OPCODE] = &&POP_FRAME_OPCODE_LABEL,
+    [LIVE_OPCODE] = &&LIVE_OPCODE_LABEL,
+    [ENTER_STACK_OPCODE] = &&ENTER_STACK_OPCODE_LABEL,
+    [YIELD_OPCODE] = &&YIELD_OPCODE_LABEL,
+    [RETURN_OPCODE] = &&RETURN_OPCODE_LABEL,
+    [DUMP_OPCODE] = &&DUMP_OPCODE_LABEL,
+    [INT_ADD_OPCODE] = &&INT_ADD_OPCODE_LABEL,
+    [INT_SUB_OPCODE] = &&INT_SUB_OPCODE_LABEL,
+    [INT_MUL_OPCODE] = &&INT_MUL_OPCODE_LABEL,
+    [INT_DIV_OPCODE] = &&INT_DIV_OPCODE_LABEL,
+    [INT_MOD_OPCODE] = &&INT_MOD_OPCODE_LABEL,
+    [INT_AND_OPCODE] = &&INT_AND_OPCODE_LABEL,
+    [INT_OR_OPCODE] = &&INT_OR_OPCODE_LABEL,
+    [INT_XOR_OPCODE] = &&INT_XOR_OPCODE_LABEL,
+    [INT_SHL_OPCODE] = &&INT_SHL_OPCODE_LABEL,
+    [INT_SHR_OPCODE] = &&INT_SHR_OPCODE_LABEL,
+    [INT_ASHR_OPCODE] = &&INT_ASHR_OPCODE_LABEL,
+    [INT_LT_OPCODE] = &&INT_LT_OPCODE_LABEL,
+    [INT_GT_OPCODE] = &&INT_GT_OPCODE_LABEL,
+    [INT_LE_OPCODE] = &&INT_LE_OPCODE_LABEL,
+    [INT_GE_OPCODE] = &&INT_GE_OPCODE_LABEL,
+    [REF_EQ_OPCODE] = &&REF_EQ_OPCODE_LABEL,
+    [EQ_OPCODE_REF] = &&EQ_OPCODE_REF_LABEL,
+    [EQ_OPCODE_BYTE] = &&EQ_OPCODE_BYTE_LABEL,
+    [EQ_OPCODE_INT] = &&EQ_OPCODE_INT_LABEL,
+    [EQ_OPCODE_LONG] = &&EQ_OPCODE_LONG_LABEL,
+    [EQ_OPCODE_FLOAT] = &&EQ_OPCODE_FLOAT_LABEL,
+    [EQ_OPCODE_DOUBLE] = &&EQ_OPCODE_DOUBLE_LABEL,
+    [REF_NE_OPCODE] = &&REF_NE_OPCODE_LABEL,
+    [NE_OPCODE_REF] = &&NE_OPCODE_REF_LABEL,
+    [NE_OPCODE_BYTE] = &&NE_OPCODE_BYTE_LABEL,
+    [NE_OPCODE_INT] = &&NE_OPCODE_INT_LABEL,
+    [NE_OPCODE_LONG] = &&NE_OPCODE_LONG_LABEL,
+    [NE_OPCODE_FLOAT] = &&NE_OPCODE_FLOAT_LABEL,
+    [NE_OPCODE_DOUBLE] = &&NE_OPCODE_DOUBLE_LABEL,
+    [ADD_OPCODE_BYTE] = &&ADD_OPCODE_BYTE_LABEL,
+    [ADD_OPCODE_INT] = &&ADD_OPCODE_INT_LABEL,
+    [ADD_OPCODE_LONG] = &&ADD_OPCODE_LONG_LABEL,
+    [ADD_OPCODE_FLOAT] = &&ADD_OPCODE_FLOAT_LABEL,
+    [ADD_OPCODE_DOUBLE] = &&ADD_OPCODE_DOUBLE_LABEL,
+    [SUB_OPCODE_BYTE] = &&SUB_OPCODE_BYTE_LABEL,
+    [SUB_OPCODE_INT] = &&SUB_OPCODE_INT_LABEL,
+    [SUB_OPCODE_LONG] = &&SUB_OPCODE_LONG_LABEL,
+    [SUB_OPCODE_FLOAT] = &&SUB_OPCODE_FLOAT_LABEL,
+    [SUB_OPCODE_DOUBLE] = &&SUB_OPCODE_DOUBLE_LABEL,
+    [MUL_OPCODE_BYTE] = &&MUL_OPCODE_BYTE_LABEL,
+    [MUL_OPCODE_INT] = &&MUL_OPCODE_INT_LABEL,
+    [MUL_OPCODE_LONG] = &&MUL_OPCODE_LONG_LABEL,
+    [MUL_OPCODE_FLOAT] = &&MUL_OPCODE_FLOAT_LABEL,
+    [MUL_OPCODE_DOUBLE] = &&MUL_OPCODE_DOUBLE_LABEL,
+    [DIV_OPCODE_BYTE] = &&DIV_OPCODE_BYTE_LABEL,
+    [DIV_OPCODE_INT] = &&DIV_OPCODE_INT_LABEL,
+    [DIV_OPCODE_LONG] = &&DIV_OPCODE_LONG_LABEL,
+    [DIV_OPCODE_FLOAT] = &&DIV_OPCODE_FLOAT_LABEL,
+    [DIV_OPCODE_DOUBLE] = &&DIV_OPCODE_DOUBLE_LABEL,
+    [MOD_OPCODE_BYTE] = &&MOD_OPCODE_BYTE_LABEL,
+    [MOD_OPCODE_INT] = &&MOD_OPCODE_INT_LABEL,
+    [MOD_OPCODE_LONG] = &&MOD_OPCODE_LONG_LABEL,
+    [AND_OPCODE_BYTE] = &&AND_OPCODE_BYTE_LABEL,
+    [AND_OPCODE_INT] = &&AND_OPCODE_INT_LABEL,
+    [AND_OPCODE_LONG] = &&AND_OPCODE_LONG_LABEL,
+    [OR_OPCODE_BYTE] = &&OR_OPCODE_BYTE_LABEL,
+    [OR_OPCODE_INT] = &&OR_OPCODE_INT_LABEL,
+    [OR_OPCODE_LONG] = &&OR_OPCODE_LONG_LABEL,
+    [XOR_OPCODE_BYTE] = &&XOR_OPCODE_BYTE_LABEL,
+    [XOR_OPCODE_INT] = &&XOR_OPCODE_INT_LABEL,
+    [XOR_OPCODE_LONG] = &&XOR_OPCODE_LONG_LABEL,
+    [SHL_OPCODE_BYTE] = &&SHL_OPCODE_BYTE_LABEL,
+    [SHL_OPCODE_INT] = &&SHL_OPCODE_INT_LABEL,
+    [SHL_OPCODE_LONG] = &&SHL_OPCODE_LONG_LABEL,
+    [SHR_OPCODE_BYTE] = &&SHR_OPCODE_BYTE_LABEL,
+    [SHR_OPCODE_INT] = &&SHR_OPCODE_INT_LABEL,
+    [SHR_OPCODE_LONG] = &&SHR_OPCODE_LONG_LABEL,
+    [ASHR_OPCODE_INT] = &&ASHR_OPCODE_INT_LABEL,
+    [ASHR_OPCODE_LONG] = &&ASHR_OPCODE_LONG_LABEL,
+    [LT_OPCODE_INT] = &&LT_OPCODE_INT_LABEL,
+    [LT_OPCODE_LONG] = &&LT_OPCODE_LONG_LABEL,
+    [LT_OPCODE_FLOAT] = &&LT_OPCODE_FLOAT_LABEL,
+    [LT_OPCODE_DOUBLE] = &&LT_OPCODE_DOUBLE_LABEL,
+    [GT_OPCODE_INT] = &&GT_OPCODE_INT_LABEL,
+    [GT_OPCODE_LONG] = &&GT_OPCODE_LONG_LABEL,
+    [GT_OPCODE_FLOAT] = &&GT_OPCODE_FLOAT_LABEL,
+    [GT_OPCODE_DOUBLE] = &&GT_OPCODE_DOUBLE_LABEL,
+    [LE_OPCODE_INT] = &&LE_OPCODE_INT_LABEL,
+    [LE_OPCODE_LONG] = &&LE_OPCODE_LONG_LABEL,
+    [LE_OPCODE_FLOAT] = &&LE_OPCODE_FLOAT_LABEL,
+    [LE_OPCODE_DOUBLE] = &&LE_OPCODE_DOUBLE_LABEL,
+    [GE_OPCODE_INT] = &&GE_OPCODE_INT_LABEL,
+    [GE_OPCODE_LONG] = &&GE_OPCODE_LONG_LABEL,
+    [GE_OPCODE_FLOAT] = &&GE_OPCODE_FLOAT_LABEL,
+    [GE_OPCODE_DOUBLE] = &&GE_OPCODE_DOUBLE_LABEL,
+    [ULE_OPCODE_BYTE] = &&ULE_OPCODE_BYTE_LABEL,
+    [ULE_OPCODE_INT] = &&ULE_OPCODE_INT_LABEL,
+    [ULE_OPCODE_LONG] = &&ULE_OPCODE_LONG_LABEL,
+    [ULT_OPCODE_BYTE] = &&ULT_OPCODE_BYTE_LABEL,
+    [ULT_OPCODE_INT] = &&ULT_OPCODE_INT_LABEL,
+    [ULT_OPCODE_LONG] = &&ULT_OPCODE_LONG_LABEL,
+    [UGT_OPCODE_BYTE] = &&UGT_OPCODE_BYTE_LABEL,
+    [UGT_OPCODE_INT] = &&UGT_OPCODE_INT_LABEL,
+    [UGT_OPCODE_LONG] = &&UGT_OPCODE_LONG_LABEL,
+    [UGE_OPCODE_BYTE] = &&UGE_OPCODE_BYTE_LABEL,
+    [UGE_OPCODE_INT] = &&UGE_OPCODE_INT_LABEL,
+    [UGE_OPCODE_LONG] = &&UGE_OPCODE_LONG_LABEL,
+    [INT_NOT_OPCODE] = &&INT_NOT_OPCODE_LABEL,
+    [INT_NEG_OPCODE] = &&INT_NEG_OPCODE_LABEL,
+    [NOT_OPCODE_BYTE] = &&NOT_OPCODE_BYTE_LABEL,
+    [NOT_OPCODE_INT] = &&NOT_OPCODE_INT_LABEL,
+    [NOT_OPCODE_LONG] = &&NOT_OPCODE_LONG_LABEL,
+    [NEG_OPCODE_INT] = &&NEG_OPCODE_INT_LABEL,
+    [NEG_OPCODE_LONG] = &&NEG_OPCODE_LONG_LABEL,
+    [NEG_OPCODE_FLOAT] = &&NEG_OPCODE_FLOAT_LABEL,
+    [NEG_OPCODE_DOUBLE] = &&NEG_OPCODE_DOUBLE_LABEL,
+    [DEREF_OPCODE] = &&DEREF_OPCODE_LABEL,
+    [TYPEOF_OPCODE] = &&TYPEOF_OPCODE_LABEL,
+    [JUMP_SET_OPCODE] = &&JUMP_SET_OPCODE_LABEL,
+    [JUMP_TAGBITS_OPCODE] = &&JUMP_TAGBITS_OPCODE_LABEL,
+    [JUMP_TAGWORD_OPCODE] = &&JUMP_TAGWORD_OPCODE_LABEL,
+    [GOTO_OPCODE] = &&GOTO_OPCODE_LABEL,
+    [CONV_OPCODE_BYTE_FLOAT] = &&CONV_OPCODE_BYTE_FLOAT_LABEL,
+    [CONV_OPCODE_BYTE_DOUBLE] = &&CONV_OPCODE_BYTE_DOUBLE_LABEL,
+    [CONV_OPCODE_INT_BYTE] = &&CONV_OPCODE_INT_BYTE_LABEL,
+    [CONV_OPCODE_INT_FLOAT] = &&CONV_OPCODE_INT_FLOAT_LABEL,
+    [CONV_OPCODE_INT_DOUBLE] = &&CONV_OPCODE_INT_DOUBLE_LABEL,
+    [CONV_OPCODE_LONG_BYTE] = &&CONV_OPCODE_LONG_BYTE_LABEL,
+    [CONV_OPCODE_LONG_INT] = &&CONV_OPCODE_LONG_INT_LABEL,
+    [CONV_OPCODE_LONG_FLOAT] = &&CONV_OPCODE_LONG_FLOAT_LABEL,
+    [CONV_OPCODE_LONG_DOUBLE] = &&CONV_OPCODE_LONG_DOUBLE_LABEL,
+    [CONV_OPCODE_FLOAT_BYTE] = &&CONV_OPCODE_FLOAT_BYTE_LABEL,
+    [CONV_OPCODE_FLOAT_INT] = &&CONV_OPCODE_FLOAT_INT_LABEL,
+    [CONV_OPCODE_FLOAT_LONG] = &&CONV_OPCODE_FLOAT_LONG_LABEL,
+    [CONV_OPCODE_FLOAT_DOUBLE] = &&CONV_OPCODE_FLOAT_DOUBLE_LABEL,
+    [CONV_OPCODE_DOUBLE_BYTE] = &&CONV_OPCODE_DOUBLE_BYTE_LABEL,
+    [CONV_OPCODE_DOUBLE_INT] = &&CONV_OPCODE_DOUBLE_INT_LABEL,
+    [CONV_OPCODE_DOUBLE_LONG] = &&CONV_OPCODE_DOUBLE_LONG_LABEL,
+    [CONV_OPCODE_DOUBLE_FLOAT] = &&CONV_OPCODE_DOUBLE_FLOAT_LABEL,
+    [DETAG_OPCODE] = &&DETAG_OPCODE_LABEL,
+    [TAG_OPCODE_BYTE] = &&TAG_OPCODE_BYTE_LABEL,
+    [TAG_OPCODE_CHAR] = &&TAG_OPCODE_CHAR_LABEL,
+    [TAG_OPCODE_INT] = &&TAG_OPCODE_INT_LABEL,
+    [TAG_OPCODE_FLOAT] = &&TAG_OPCODE_FLOAT_LABEL,
+    [STORE_OPCODE_1] = &&STORE_OPCODE_1_LABEL,
+    [STORE_OPCODE_4] = &&STORE_OPCODE_4_LABEL,
+    [STORE_OPCODE_8] = &&STORE_OPCODE_8_LABEL,
+    [STORE_OPCODE_1_VAR_OFFSET] = &&STORE_OPCODE_1_VAR_OFFSET_LABEL,
+    [STORE_OPCODE_4_VAR_OFFSET] = &&STORE_OPCODE_4_VAR_OFFSET_LABEL,
+    [STORE_OPCODE_8_VAR_OFFSET] = &&STORE_OPCODE_8_VAR_OFFSET_LABEL,
+    [STORE_WITH_BARRIER_OPCODE] = &&STORE_WITH_BARRIER_OPCODE_LABEL,
+    [STORE_WITH_BARRIER_OPCODE_VAR_OFFSET] = &&STORE_WITH_BARRIER_OPCODE_VAR_OFFSET_LABEL,
+    [JUMP_EQ_OPCODE_CONST] = &&JUMP_EQ_OPCODE_CONST_LABEL,
+    [JUMP_NE_OPCODE_CONST] = &&JUMP_NE_OPCODE_CONST_LABEL,
+    [POP_FRAME_GET_REG_OPCODE] = &&POP_FRAME_GET_REG_OPCODE_LABEL,
+    [SET_REG_OPCODE_LOCAL_2] = &&SET_REG_OPCODE_LOCAL_2_LABEL,
+    [GET_REG_OPCODE_2] = &&GET_REG_OPCODE_2_LABEL,
+    [LOAD_OPCODE_1] = &&LOAD_OPCODE_1_LABEL,
+    [LOAD_OPCODE_4] = &&LOAD_OPCODE_4_LABEL,
+    [LOAD_OPCODE_8] = &&LOAD_OPCODE_8_LABEL,
+    [LOAD_OPCODE_1_VAR_OFFSET] = &&LOAD_OPCODE_1_VAR_OFFSET_LABEL,
+    [LOAD_OPCODE_4_VAR_OFFSET] = &&LOAD_OPCODE_4_VAR_OFFSET_LABEL,
+    [LOAD_OPCODE_8_VAR_OFFSET] = &&LOAD_OPCODE_8_VAR_OFFSET_LABEL,
+    [RESERVE_OPCODE_LOCAL] = &&RESERVE_OPCODE_LOCAL_LABEL,
+    [RESERVE_OPCODE_CONST] = &&RESERVE_OPCODE_CONST_LABEL,
+    [ALLOC_OPCODE_CONST] = &&ALLOC_OPCODE_CONST_LABEL,
+    [ALLOC_OPCODE_LOCAL] = &&ALLOC_OPCODE_LOCAL_LABEL,
+    [GC_OPCODE] = &&GC_OPCODE_LABEL,
+    [PRINT_STACK_TRACE_OPCODE] = &&PRINT_STACK_TRACE_OPCODE_LABEL,
+    [COLLECT_STACK_TRACE_OPCODE] = &&COLLECT_STACK_TRACE_OPCODE_LABEL,
+    [FLUSH_VM_OPCODE] = &&FLUSH_VM_OPCODE_LABEL,
+    [C_RSP_OPCODE] = &&C_RSP_OPCODE_LABEL,
+    [JUMP_INT_LT_OPCODE] = &&JUMP_INT_LT_OPCODE_LABEL,
+    [JUMP_INT_GT_OPCODE] = &&JUMP_INT_GT_OPCODE_LABEL,
+    [JUMP_INT_LE_OPCODE] = &&JUMP_INT_LE_OPCODE_LABEL,
+    [JUMP_INT_GE_OPCODE] = &&JUMP_INT_GE_OPCODE_LABEL,
+    [JUMP_EQ_OPCODE_REF] = &&JUMP_EQ_OPCODE_REF_LABEL,
+    [JUMP_EQ_OPCODE_BYTE] = &&JUMP_EQ_OPCODE_BYTE_LABEL,
+    [JUMP_EQ_OPCODE_INT] = &&JUMP_EQ_OPCODE_INT_LABEL,
+    [JUMP_EQ_OPCODE_LONG] = &&JUMP_EQ_OPCODE_LONG_LABEL,
+    [JUMP_EQ_OPCODE_FLOAT] = &&JUMP_EQ_OPCODE_FLOAT_LABEL,
+    [JUMP_EQ_OPCODE_DOUBLE] = &&JUMP_EQ_OPCODE_DOUBLE_LABEL,
+    [JUMP_NE_OPCODE_REF] = &&JUMP_NE_OPCODE_REF_LABEL,
+    [JUMP_NE_OPCODE_BYTE] = &&JUMP_NE_OPCODE_BYTE_LABEL,
+    [JUMP_NE_OPCODE_INT] = &&JUMP_NE_OPCODE_INT_LABEL,
+    [JUMP_NE_OPCODE_LONG] = &&JUMP_NE_OPCODE_LONG_LABEL,
+    [JUMP_NE_OPCODE_FLOAT] = &&JUMP_NE_OPCODE_FLOAT_LABEL,
+    [JUMP_NE_OPCODE_DOUBLE] = &&JUMP_NE_OPCODE_DOUBLE_LABEL,
+    [JUMP_LT_OPCODE_INT] = &&JUMP_LT_OPCODE_INT_LABEL,
+    [JUMP_LT_OPCODE_LONG] = &&JUMP_LT_OPCODE_LONG_LABEL,
+    [JUMP_LT_OPCODE_FLOAT] = &&JUMP_LT_OPCODE_FLOAT_LABEL,
+    [JUMP_LT_OPCODE_DOUBLE] = &&JUMP_LT_OPCODE_DOUBLE_LABEL,
+    [JUMP_GT_OPCODE_INT] = &&JUMP_GT_OPCODE_INT_LABEL,
+    [JUMP_GT_OPCODE_LONG] = &&JUMP_GT_OPCODE_LONG_LABEL,
+    [JUMP_GT_OPCODE_FLOAT] = &&JUMP_GT_OPCODE_FLOAT_LABEL,
+    [JUMP_GT_OPCODE_DOUBLE] = &&JUMP_GT_OPCODE_DOUBLE_LABEL,
+    [JUMP_LE_OPCODE_INT] = &&JUMP_LE_OPCODE_INT_LABEL,
+    [JUMP_LE_OPCODE_LONG] = &&JUMP_LE_OPCODE_LONG_LABEL,
+    [JUMP_LE_OPCODE_FLOAT] = &&JUMP_LE_OPCODE_FLOAT_LABEL,
+    [JUMP_LE_OPCODE_DOUBLE] = &&JUMP_LE_OPCODE_DOUBLE_LABEL,
+    [JUMP_GE_OPCODE_INT] = &&JUMP_GE_OPCODE_INT_LABEL,
+    [JUMP_GE_OPCODE_LONG] = &&JUMP_GE_OPCODE_LONG_LABEL,
+    [JUMP_GE_OPCODE_FLOAT] = &&JUMP_GE_OPCODE_FLOAT_LABEL,
+    [JUMP_GE_OPCODE_DOUBLE] = &&JUMP_GE_OPCODE_DOUBLE_LABEL,
+    [JUMP_ULE_OPCODE_BYTE] = &&JUMP_ULE_OPCODE_BYTE_LABEL,
+    [JUMP_ULE_OPCODE_INT] = &&JUMP_ULE_OPCODE_INT_LABEL,
+    [JUMP_ULE_OPCODE_LONG] = &&JUMP_ULE_OPCODE_LONG_LABEL,
+    [JUMP_ULT_OPCODE_BYTE] = &&JUMP_ULT_OPCODE_BYTE_LABEL,
+    [JUMP_ULT_OPCODE_INT] = &&JUMP_ULT_OPCODE_INT_LABEL,
+    [JUMP_ULT_OPCODE_LONG] = &&JUMP_ULT_OPCODE_LONG_LABEL,
+    [JUMP_UGE_OPCODE_BYTE] = &&JUMP_UGE_OPCODE_BYTE_LABEL,
+    [JUMP_UGE_OPCODE_INT] = &&JUMP_UGE_OPCODE_INT_LABEL,
+    [JUMP_UGE_OPCODE_LONG] = &&JUMP_UGE_OPCODE_LONG_LABEL,
+    [JUMP_UGT_OPCODE_BYTE] = &&JUMP_UGT_OPCODE_BYTE_LABEL,
+    [JUMP_UGT_OPCODE_INT] = &&JUMP_UGT_OPCODE_INT_LABEL,
+    [JUMP_UGT_OPCODE_LONG] = &&JUMP_UGT_OPCODE_LONG_LABEL,
+    [DISPATCH_OPCODE] = &&DISPATCH_OPCODE_LABEL,
+    [DISPATCH_METHOD_OPCODE] = &&DISPATCH_METHOD_OPCODE_LABEL,
+    [JUMP_REG_OPCODE] = &&JUMP_REG_OPCODE_LABEL,
+    [FNENTRY_OPCODE] = &&FNENTRY_OPCODE_LABEL,
+    [LOWEST_ZERO_BIT_COUNT_OPCODE_LONG] = &&LOWEST_ZERO_BIT_COUNT_OPCODE_LONG_LABEL,
+    [SET_BIT_OPCODE] = &&SET_BIT_OPCODE_LABEL,
+    [CLEAR_BIT_OPCODE] = &&CLEAR_BIT_OPCODE_LABEL,
+    [TEST_BIT_OPCODE] = &&TEST_BIT_OPCODE_LABEL,
+    [TEST_AND_SET_BIT_OPCODE] = &&TEST_AND_SET_BIT_OPCODE_LABEL,
+    [TEST_AND_CLEAR_BIT_OPCODE] = &&TEST_AND_CLEAR_BIT_OPCODE_LABEL,
+  };
+#endif
+
   //Repl Loop
   while(1){
     //icounter++;
@@ -613,125 +1359,120 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
 
     //Save pre-decode PC because jump offsets are relative to
     //pre-decode PC.
-    char* pc0 = pc;
-    uint32_t W1 = PC_INT();
-    int opcode = W1 & 0xFF;
-
-    //uint64_t curtime = current_time_ms();
-    //if(last_opcode >= 0)
-    //  timings[last_opcode] += curtime - last_time;
-    //last_opcode = opcode;
-    //last_time = curtime;
+    pc0 = pc;
+    W1 = PC_INT();
+    opcode = W1 & 0xFF;
+    PROFILE_INS();
 
     switch(opcode){
-    case SET_OPCODE_LOCAL : {
+    VM_CASE(SET_OPCODE_LOCAL) {
       DECODE_C();
       SET_LOCAL(y, LOCAL(value));
-      continue;
+      NEXT();
     }
-    case SET_OPCODE_UNSIGNED : {
+    VM_CASE(SET_OPCODE_UNSIGNED) {
       DECODE_C();
       SET_LOCAL(y, (uint64_t)value);
-      continue;
+      NEXT();
     }
-    case SET_OPCODE_SIGNED : {
+    VM_CASE(SET_OPCODE_SIGNED) {
       DECODE_C();
       SET_LOCAL(y, (int64_t)(int32_t)value);
-      continue;
+      NEXT();
     }
-    case SET_OPCODE_CODE : {
+    VM_CASE(SET_OPCODE_CODE) {
       DECODE_C();
       SET_LOCAL(y, value);
-      continue;
+      NEXT();
     }
-    case SET_OPCODE_GLOBAL : {
+    VM_CASE(SET_OPCODE_GLOBAL) {
       DECODE_C();
       char* address = global_mem + global_offsets[value];
       SET_LOCAL(y, (uint64_t)address);
-      continue;
+      NEXT();
     }
-    case SET_OPCODE_DATA : {
+    VM_CASE(SET_OPCODE_DATA) {
       DECODE_C();
       char* address = data_mem + 8 * data_offsets[value];
       SET_LOCAL(y, (uint64_t)address);
-      continue;
+      NEXT();
     }
-    case SET_OPCODE_CONST : {
+    VM_CASE(SET_OPCODE_CONST) {
       DECODE_C();
       SET_LOCAL(y, const_table[value]);
-      continue;
+      NEXT();
     }
-    case SET_OPCODE_WIDE : {
+    VM_CASE(SET_OPCODE_WIDE) {
       DECODE_D();
       SET_LOCAL(x, value);
-      continue;
+      NEXT();
     }
-    case SET_REG_OPCODE_LOCAL : {
+    VM_CASE(SET_REG_OPCODE_LOCAL) {
       DECODE_C();
       SET_REG(y, LOCAL(value));
-      continue;
+      NEXT();
     }
-    case SET_REG_OPCODE_UNSIGNED : {
+    VM_CASE(SET_REG_OPCODE_UNSIGNED) {
       DECODE_C();
       SET_REG(y, (uint64_t)value);
-      continue;
+      NEXT();
     }
-    case SET_REG_OPCODE_SIGNED : {
+    VM_CASE(SET_REG_OPCODE_SIGNED) {
       DECODE_C();
       SET_REG(y, (int64_t)(int32_t)value);
-      continue;
+      NEXT();
     }
-    case SET_REG_OPCODE_CODE : {
+    VM_CASE(SET_REG_OPCODE_CODE) {
       DECODE_C();
       SET_REG(y, value);
-      continue;
+      NEXT();
     }
-    case SET_REG_OPCODE_GLOBAL : {
+    VM_CASE(SET_REG_OPCODE_GLOBAL) {
       DECODE_C();
       char* address = global_mem + global_offsets[value];
       SET_REG(y, (uint64_t)address);
-      continue;
+      NEXT();
     }
-    case SET_REG_OPCODE_DATA : {
+    VM_CASE(SET_REG_OPCODE_DATA) {
       DECODE_C();
       char* address = data_mem + 8 * data_offsets[value];
       SET_REG(y, (uint64_t)address);
-      continue;
+      NEXT();
     }
-    case SET_REG_OPCODE_CONST : {
+    VM_CASE(SET_REG_OPCODE_CONST) {
       DECODE_C();
       SET_REG(y, const_table[value]);
-      continue;
+      NEXT();
     }
-    case SET_REG_OPCODE_WIDE : {
+    VM_CASE(SET_REG_OPCODE_WIDE) {
       DECODE_D();
       SET_REG(x, value);
-      continue;
+      NEXT();
     }
-    case GET_REG_OPCODE : {
+    VM_CASE(GET_REG_OPCODE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, registers[value]);
-      continue;
+      NEXT();
     }
-    case CALL_OPCODE_LOCAL : {
+    VM_CASE(CALL_OPCODE_LOCAL) {
       DECODE_C();
       int num_locals = y;
       uint64_t fid = LOCAL(value);
       uint64_t fpos = (uint64_t)(code_offsets[fid]) * 4;
       PUSH_FRAME(num_locals);
       pc = instructions + fpos;
-      continue;
+      NEXT();
     }
-    case CALL_OPCODE_CODE : {
+    VM_CASE(CALL_OPCODE_CODE) {
       DECODE_C();
       int num_locals = y;
       uint64_t fid = value;
       uint64_t fpos = (uint64_t)(code_offsets[fid]) * 4;
       PUSH_FRAME(num_locals);
       pc = instructions + fpos;
-      continue;
+      NEXT();
     }
-    case CALL_CLOSURE_OPCODE : {
+    VM_CASE(CALL_CLOSURE_OPCODE) {
       DECODE_C();
       int num_locals = y;
       Function* clo = (Function*)(LOCAL(value) - REF_TAG_BITS + 8);
@@ -739,68 +1480,72 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
       uint64_t fpos = (uint64_t)(code_offsets[fid]) * 4;
       PUSH_FRAME(num_locals);
       pc = instructions + fpos;
-      continue;
+      NEXT();
     }
-    case TCALL_OPCODE_LOCAL : {
+    VM_CASE(TCALL_OPCODE_LOCAL) {
       DECODE_C();
       int num_locals = y;
       uint64_t fid = LOCAL(value);
       uint64_t fpos = (uint64_t)(code_offsets[fid]) * 4;
       pc = instructions + fpos;
-      continue;
+      NEXT();
     }
-    case TCALL_OPCODE_CODE : {
+    VM_CASE(TCALL_OPCODE_CODE) {
       DECODE_C();
       int num_locals = y;
       uint64_t fid = value;
       uint64_t fpos = (uint64_t)(code_offsets[fid]) * 4;
       pc = instructions + fpos;
-      continue;
+      NEXT();
     }
-    case TCALL_CLOSURE_OPCODE : {
+    VM_CASE(TCALL_CLOSURE_OPCODE) {
       DECODE_A_UNSIGNED();
       Function* clo = (Function*)(LOCAL(value) - REF_TAG_BITS + 8);
       uint64_t fid = clo->code;
       uint64_t fpos = (uint64_t)(code_offsets[fid]) * 4;
       pc = instructions + fpos;
-      continue;
+      NEXT();
     }
-    case CALLC_OPCODE_LOCAL : {
+    VM_CASE(CALLC_OPCODE_LOCAL) {
       DECODE_C();
       void* faddr = (void*)LOCAL(value);
       int num_locals = y;
       PUSH_FRAME(num_locals);
       SAVE_STATE();
+      PROFILE_START();
       c_trampoline(faddr, registers, registers);
+      PROFILE_END(c_time, num_c_calls);
       RESTORE_STATE();
       pc = instructions + stack_pointer->returnpc;
       POP_FRAME(num_locals);
-      continue;
+      NEXT();
     }
-    case CALLC_OPCODE_WIDE : {
+    VM_CASE(CALLC_OPCODE_WIDE) {
       DECODE_D();
       void* faddr = (void*)(uint64_t)value;
       int num_locals = x;
       PUSH_FRAME(num_locals);
       SAVE_STATE();
+      PROFILE_START();
       c_trampoline(faddr, registers, registers);
+      PROFILE_END(c_time, num_c_calls);
       RESTORE_STATE();
       pc = instructions + stack_pointer->returnpc;
       POP_FRAME(num_locals);
-      continue;
+      NEXT();
     }
-    case POP_FRAME_OPCODE : {
+    VM_CASE(POP_FRAME_OPCODE) {
       DECODE_A_UNSIGNED();
       int num_locals = value;
       POP_FRAME(num_locals);
-      continue;
+      NEXT();
     }
-    case LIVE_OPCODE : {
+    VM_CASE(LIVE_OPCODE) {
       DECODE_A_UNSIGNED();
       stack_pointer->liveness_map = value;
-      continue;
+      NEXT();
     }
-    case ENTER_STACK_OPCODE : {
+    VM_CASE(ENTER_STACK_OPCODE) {
       DECODE_A_UNSIGNED();
       //Save current stack
       stk->stack_pointer = stack_pointer;
@@ -814,9 +1559,9 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
       uint64_t fid = stk->pc;
       uint64_t stk_pc = code_offsets[fid] * 4;
       pc = instructions + stk_pc;
-      continue;
+      NEXT();
     }
-    case YIELD_OPCODE : {
+    VM_CASE(YIELD_OPCODE) {
       DECODE_A_UNSIGNED();
       //Save current stack
       stk->stack_pointer = stack_pointer;
@@ -827,9 +1572,9 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
       stack_pointer = stk->stack_pointer;
       stack_limit = (char*)(stk->frames) + stk->size;
       pc = instructions + stk->pc;
-      continue;
+      NEXT();
     }
-    case RETURN_OPCODE : {
+    VM_CASE(RETURN_OPCODE) {
       DECODE_A_UNSIGNED();
       int64_t retpc = stack_pointer->returnpc;
       if(retpc == SYSTEM_RETURN_STUB){
@@ -850,21 +1595,21 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
         retpc = stk->pc;
 
         pc = instructions + retpc;
-        continue;
+        NEXT();
       }
       else if(retpc < 0){
         //Save registers
         SAVE_STATE();
-        //for(int i=0; i<255; i++)
-        //  printf("Time of opcode %d = %llu\n", i, timings[i]);
+        if(profile && --profile->depth == 0)
+          profile->vm_time += current_time_us() - profile_vm_t0;
         return;
       }
       else{
         pc = instructions + retpc;
-        continue;
+        NEXT();
       }
     }
-    case DUMP_OPCODE : {
+    VM_CASE(DUMP_OPCODE) {
       DECODE_A_UNSIGNED();
       int64_t xl = (int64_t)LOCAL(value);
       char xb = (char)xl;
@@ -873,574 +1618,574 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
       float xd = LOCAL_DOUBLE(value);
       printf("DUMP LOCAL %d: (byte = %d, int = %d, long = %" PRId64 ", ptr = %p, float = %f, double = %f)\n",
              value, xb, xi, xl, (void*)xl, xf, xd);
-      continue;
+      NEXT();
     }
-    case INT_ADD_OPCODE : {
+    VM_CASE(INT_ADD_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) + (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case INT_SUB_OPCODE : {
+    VM_CASE(INT_SUB_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) - (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case INT_MUL_OPCODE : {
+    VM_CASE(INT_MUL_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, ((int64_t)(LOCAL(y)) >> 32L) * (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case INT_DIV_OPCODE : {
+    VM_CASE(INT_DIV_OPCODE) {
       DECODE_C();
       int64_t sy = (int64_t)LOCAL(y);
       int64_t sz = (int64_t)LOCAL(value);
       SET_LOCAL(x, (sy / sz) << 32L);
-      continue;
+      NEXT();
     }
-    case INT_MOD_OPCODE : {
+    VM_CASE(INT_MOD_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) % (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case INT_AND_OPCODE : {
+    VM_CASE(INT_AND_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) & (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case INT_OR_OPCODE : {
+    VM_CASE(INT_OR_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) | (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case INT_XOR_OPCODE : {
+    VM_CASE(INT_XOR_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) ^ (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case INT_SHL_OPCODE : {
+    VM_CASE(INT_SHL_OPCODE) {
       DECODE_C();
       int64_t sy = (int64_t)LOCAL(y);
       int64_t sz = (int64_t)LOCAL(value);
       SET_LOCAL(x, sy << (sz >> 32L));
-      continue;
+      NEXT();
     }
-    case INT_SHR_OPCODE : {
+    VM_CASE(INT_SHR_OPCODE) {
       DECODE_C();
       uint64_t uy = LOCAL(y);
       int64_t sz = (int64_t)LOCAL(value);
       uint64_t r = uy >> (sz >> 32L);
       SET_LOCAL(x, (r >> 32L) << 32L);
-      continue;
+      NEXT();
     }
-    case INT_ASHR_OPCODE : {
+    VM_CASE(INT_ASHR_OPCODE) {
       DECODE_C();
       int64_t sy = (int64_t)LOCAL(y);
       int64_t sz = (int64_t)LOCAL(value);
       uint64_t r = sy >> (sz >> 32L);
       SET_LOCAL(x, (r >> 32L) << 32L);
-      continue;
+      NEXT();
     }
-    case INT_LT_OPCODE : {
+    VM_CASE(INT_LT_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, BOOLREF((int64_t)(LOCAL(y)) < (int64_t)(LOCAL(value))));
-      continue;
+      NEXT();
     }
-    case INT_GT_OPCODE : {
+    VM_CASE(INT_GT_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, BOOLREF((int64_t)(LOCAL(y)) > (int64_t)(LOCAL(value))));
-      continue;
+      NEXT();
     }
-    case INT_LE_OPCODE : {
+    VM_CASE(INT_LE_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, BOOLREF((int64_t)(LOCAL(y)) <= (int64_t)(LOCAL(value))));
-      continue;
+      NEXT();
     }
-    case INT_GE_OPCODE : {
+    VM_CASE(INT_GE_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, BOOLREF((int64_t)(LOCAL(y)) >= (int64_t)(LOCAL(value))));
-      continue;
+      NEXT();
     }
-    case REF_EQ_OPCODE : {
+    VM_CASE(REF_EQ_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, BOOLREF(LOCAL(y) == LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case EQ_OPCODE_REF : {
+    VM_CASE(EQ_OPCODE_REF) {
       DECODE_C();
       SET_LOCAL(x, LOCAL(y) == LOCAL(value));
-      continue;
+      NEXT();
     }
-    case EQ_OPCODE_BYTE : {
+    VM_CASE(EQ_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (uint8_t)LOCAL(y) == (uint8_t)LOCAL(value));
-      continue;
+      NEXT();
     }
-    case EQ_OPCODE_INT : {
+    VM_CASE(EQ_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)LOCAL(y) == (int32_t)LOCAL(value));
-      continue;
+      NEXT();
     }
-    case EQ_OPCODE_LONG : {
+    VM_CASE(EQ_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)LOCAL(y) == (int64_t)LOCAL(value));
-      continue;
+      NEXT();
     }
-    case EQ_OPCODE_FLOAT : {
+    VM_CASE(EQ_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_FLOAT(y) == LOCAL_FLOAT(value));
-      continue;
+      NEXT();
     }
-    case EQ_OPCODE_DOUBLE : {
+    VM_CASE(EQ_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_DOUBLE(y) == LOCAL_DOUBLE(value));
-      continue;
+      NEXT();
     }
-    case REF_NE_OPCODE : {
+    VM_CASE(REF_NE_OPCODE) {
       DECODE_C();
       SET_LOCAL(x, BOOLREF(LOCAL(y) != LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case NE_OPCODE_REF : {
+    VM_CASE(NE_OPCODE_REF) {
       DECODE_C();
       SET_LOCAL(x, LOCAL(y) != LOCAL(value));
-      continue;
+      NEXT();
     }
-    case NE_OPCODE_BYTE : {
+    VM_CASE(NE_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (uint8_t)LOCAL(y) != (uint8_t)LOCAL(value));
-      continue;
+      NEXT();
     }
-    case NE_OPCODE_INT : {
+    VM_CASE(NE_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)LOCAL(y) != (int32_t)LOCAL(value));
-      continue;
+      NEXT();
     }
-    case NE_OPCODE_LONG : {
+    VM_CASE(NE_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)LOCAL(y) != (int64_t)LOCAL(value));
-      continue;
+      NEXT();
     }
-    case NE_OPCODE_FLOAT : {
+    VM_CASE(NE_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_FLOAT(y) != LOCAL_FLOAT(value));
-      continue;
+      NEXT();
     }
-    case NE_OPCODE_DOUBLE : {
+    VM_CASE(NE_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_DOUBLE(y) != LOCAL_DOUBLE(value));
-      continue;
+      NEXT();
     }
-    case ADD_OPCODE_BYTE : {
+    VM_CASE(ADD_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) + (char)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case ADD_OPCODE_INT : {
+    VM_CASE(ADD_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) + (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case ADD_OPCODE_LONG : {
+    VM_CASE(ADD_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) + (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case ADD_OPCODE_FLOAT : {
+    VM_CASE(ADD_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL_FLOAT(x, LOCAL_FLOAT(y) + LOCAL_FLOAT(value));
-      continue;
+      NEXT();
     }
-    case ADD_OPCODE_DOUBLE : {
+    VM_CASE(ADD_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL_DOUBLE(x, LOCAL_DOUBLE(y) + LOCAL_DOUBLE(value));
-      continue;
+      NEXT();
     }
-    case SUB_OPCODE_BYTE : {
+    VM_CASE(SUB_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) - (char)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case SUB_OPCODE_INT : {
+    VM_CASE(SUB_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) - (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case SUB_OPCODE_LONG : {
+    VM_CASE(SUB_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) - (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case SUB_OPCODE_FLOAT : {
+    VM_CASE(SUB_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL_FLOAT(x, LOCAL_FLOAT(y) - LOCAL_FLOAT(value));
-      continue;
+      NEXT();
     }
-    case SUB_OPCODE_DOUBLE : {
+    VM_CASE(SUB_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL_DOUBLE(x, LOCAL_DOUBLE(y) - LOCAL_DOUBLE(value));
-      continue;
+      NEXT();
     }
-    case MUL_OPCODE_BYTE : {
+    VM_CASE(MUL_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) * (char)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case MUL_OPCODE_INT : {
+    VM_CASE(MUL_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) * (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case MUL_OPCODE_LONG : {
+    VM_CASE(MUL_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) * (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case MUL_OPCODE_FLOAT : {
+    VM_CASE(MUL_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL_FLOAT(x, LOCAL_FLOAT(y) * LOCAL_FLOAT(value));
-      continue;
+      NEXT();
     }
-    case MUL_OPCODE_DOUBLE : {
+    VM_CASE(MUL_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL_DOUBLE(x, LOCAL_DOUBLE(y) * LOCAL_DOUBLE(value));
-      continue;
+      NEXT();
     }
-    case DIV_OPCODE_BYTE : {
+    VM_CASE(DIV_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) / (char)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case DIV_OPCODE_INT : {
+    VM_CASE(DIV_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) / (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case DIV_OPCODE_LONG : {
+    VM_CASE(DIV_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) / (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case DIV_OPCODE_FLOAT : {
+    VM_CASE(DIV_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL_FLOAT(x, LOCAL_FLOAT(y) / LOCAL_FLOAT(value));
-      continue;
+      NEXT();
     }
-    case DIV_OPCODE_DOUBLE : {
+    VM_CASE(DIV_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL_DOUBLE(x, LOCAL_DOUBLE(y) / LOCAL_DOUBLE(value));
-      continue;
+      NEXT();
     }
-    case MOD_OPCODE_BYTE : {
+    VM_CASE(MOD_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) % (char)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case MOD_OPCODE_INT : {
+    VM_CASE(MOD_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) % (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case MOD_OPCODE_LONG : {
+    VM_CASE(MOD_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) % (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case AND_OPCODE_BYTE : {
+    VM_CASE(AND_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) & (char)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case AND_OPCODE_INT : {
+    VM_CASE(AND_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) & (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case AND_OPCODE_LONG : {
+    VM_CASE(AND_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) & (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case OR_OPCODE_BYTE : {
+    VM_CASE(OR_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) | (char)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case OR_OPCODE_INT : {
+    VM_CASE(OR_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) | (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case OR_OPCODE_LONG : {
+    VM_CASE(OR_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) | (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case XOR_OPCODE_BYTE : {
+    VM_CASE(XOR_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) ^ (char)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case XOR_OPCODE_INT : {
+    VM_CASE(XOR_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) ^ (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case XOR_OPCODE_LONG : {
+    VM_CASE(XOR_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) ^ (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case SHL_OPCODE_BYTE : {
+    VM_CASE(SHL_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (char)(LOCAL(y)) << (char)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case SHL_OPCODE_INT : {
+    VM_CASE(SHL_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) << (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case SHL_OPCODE_LONG : {
+    VM_CASE(SHL_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) << (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case SHR_OPCODE_BYTE : {
+    VM_CASE(SHR_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (unsigned char)(LOCAL(y)) >> (unsigned char)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case SHR_OPCODE_INT : {
+    VM_CASE(SHR_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (uint32_t)(LOCAL(y)) >> (uint32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case SHR_OPCODE_LONG : {
+    VM_CASE(SHR_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (uint64_t)(LOCAL(y)) >> (uint64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case ASHR_OPCODE_INT : {
+    VM_CASE(ASHR_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) >> (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case ASHR_OPCODE_LONG : {
+    VM_CASE(ASHR_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) >> (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case LT_OPCODE_INT : {
+    VM_CASE(LT_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) < (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case LT_OPCODE_LONG : {
+    VM_CASE(LT_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) < (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case LT_OPCODE_FLOAT : {
+    VM_CASE(LT_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_FLOAT(y) < LOCAL_FLOAT(value));
-      continue;
+      NEXT();
     }
-    case LT_OPCODE_DOUBLE : {
+    VM_CASE(LT_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_DOUBLE(y) < LOCAL_DOUBLE(value));
-      continue;
+      NEXT();
     }
-    case GT_OPCODE_INT : {
+    VM_CASE(GT_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) > (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case GT_OPCODE_LONG : {
+    VM_CASE(GT_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) > (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case GT_OPCODE_FLOAT : {
+    VM_CASE(GT_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_FLOAT(y) > LOCAL_FLOAT(value));
-      continue;
+      NEXT();
     }
-    case GT_OPCODE_DOUBLE : {
+    VM_CASE(GT_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_DOUBLE(y) > LOCAL_DOUBLE(value));
-      continue;
+      NEXT();
     }
-    case LE_OPCODE_INT : {
+    VM_CASE(LE_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) <= (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case LE_OPCODE_LONG : {
+    VM_CASE(LE_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) <= (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case LE_OPCODE_FLOAT : {
+    VM_CASE(LE_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_FLOAT(y) <= LOCAL_FLOAT(value));
-      continue;
+      NEXT();
     }
-    case LE_OPCODE_DOUBLE : {
+    VM_CASE(LE_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_DOUBLE(y) <= LOCAL_DOUBLE(value));
-      continue;
+      NEXT();
     }
-    case GE_OPCODE_INT : {
+    VM_CASE(GE_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (int32_t)(LOCAL(y)) >= (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case GE_OPCODE_LONG : {
+    VM_CASE(GE_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (int64_t)(LOCAL(y)) >= (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case GE_OPCODE_FLOAT : {
+    VM_CASE(GE_OPCODE_FLOAT) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_FLOAT(y) >= LOCAL_FLOAT(value));
-      continue;
+      NEXT();
     }
-    case GE_OPCODE_DOUBLE : {
+    VM_CASE(GE_OPCODE_DOUBLE) {
       DECODE_C();
       SET_LOCAL(x, LOCAL_DOUBLE(y) >= LOCAL_DOUBLE(value));
-      continue;
+      NEXT();
     }
 
-    case ULE_OPCODE_BYTE : {
+    VM_CASE(ULE_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (uint8_t)(LOCAL(y)) <= (uint8_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case ULE_OPCODE_INT : {
+    VM_CASE(ULE_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (uint32_t)(LOCAL(y)) <= (uint32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case ULE_OPCODE_LONG : {
+    VM_CASE(ULE_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (uint64_t)(LOCAL(y)) <= (uint64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case ULT_OPCODE_BYTE : {
+    VM_CASE(ULT_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (uint8_t)(LOCAL(y)) < (uint8_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case ULT_OPCODE_INT : {
+    VM_CASE(ULT_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (uint32_t)(LOCAL(y)) < (uint32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case ULT_OPCODE_LONG : {
+    VM_CASE(ULT_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (uint64_t)(LOCAL(y)) < (uint64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case UGT_OPCODE_BYTE : {
+    VM_CASE(UGT_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (uint8_t)(LOCAL(y)) > (uint8_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case UGT_OPCODE_INT : {
+    VM_CASE(UGT_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (uint32_t)(LOCAL(y)) > (uint32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case UGT_OPCODE_LONG : {
+    VM_CASE(UGT_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (uint64_t)(LOCAL(y)) > (uint64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case UGE_OPCODE_BYTE : {
+    VM_CASE(UGE_OPCODE_BYTE) {
       DECODE_C();
       SET_LOCAL(x, (uint8_t)(LOCAL(y)) >= (uint8_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case UGE_OPCODE_INT : {
+    VM_CASE(UGE_OPCODE_INT) {
       DECODE_C();
       SET_LOCAL(x, (uint32_t)(LOCAL(y)) >= (uint32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case UGE_OPCODE_LONG : {
+    VM_CASE(UGE_OPCODE_LONG) {
       DECODE_C();
       SET_LOCAL(x, (uint64_t)(LOCAL(y)) >= (uint64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case INT_NOT_OPCODE : {
+    VM_CASE(INT_NOT_OPCODE) {
       DECODE_B_UNSIGNED();
       uint64_t y = LOCAL(value);
       SET_LOCAL(x, ((~ y) >> 32L) << 32L);
-      continue;
+      NEXT();
     }
-    case INT_NEG_OPCODE : {
+    VM_CASE(INT_NEG_OPCODE) {
       DECODE_B_UNSIGNED();
       int64_t y = LOCAL(value);
       SET_LOCAL(x, - y);
-      continue;
+      NEXT();
     }
-    case NOT_OPCODE_BYTE : {
+    VM_CASE(NOT_OPCODE_BYTE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ~ ((uint8_t)LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case NOT_OPCODE_INT : {
+    VM_CASE(NOT_OPCODE_INT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ~ ((uint32_t)LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case NOT_OPCODE_LONG : {
+    VM_CASE(NOT_OPCODE_LONG) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ~ ((uint64_t)LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case NEG_OPCODE_INT : {
+    VM_CASE(NEG_OPCODE_INT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, - ((int32_t)LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case NEG_OPCODE_LONG : {
+    VM_CASE(NEG_OPCODE_LONG) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, - ((int64_t)LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case NEG_OPCODE_FLOAT : {
+    VM_CASE(NEG_OPCODE_FLOAT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_FLOAT(x, - LOCAL_FLOAT(value));
-      continue;
+      NEXT();
     }
-    case NEG_OPCODE_DOUBLE : {
+    VM_CASE(NEG_OPCODE_DOUBLE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_DOUBLE(x, - LOCAL_DOUBLE(value));
-      continue;
+      NEXT();
     }
-    case DEREF_OPCODE : {
+    VM_CASE(DEREF_OPCODE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, LOCAL(value) + 8 - REF_TAG_BITS);
-      continue;
+      NEXT();
     }
-    case TYPEOF_OPCODE : {
+    VM_CASE(TYPEOF_OPCODE) {
       DECODE_C();
       int format = value;
-      int index = read_dispatch_table(vms, format);
+      int index = read_cached_dispatch_table(vms, pc0 - instructions, format);
       SET_LOCAL(x, index);
-      continue;
+      NEXT();
     }
-    case JUMP_SET_OPCODE : {
+    VM_CASE(JUMP_SET_OPCODE) {
       DECODE_F();
       F_JUMP(LOCAL(x));
     }
-    case JUMP_TAGBITS_OPCODE : {
+    VM_CASE(JUMP_TAGBITS_OPCODE) {
       DECODE_F();
       int tagbits = (int)(LOCAL(x)) & 0x7;
       int bits = y;
       F_JUMP(tagbits == bits);
     }
-    case JUMP_TAGWORD_OPCODE : {
+    VM_CASE(JUMP_TAGWORD_OPCODE) {
       DECODE_F();
       uint64_t obj = LOCAL(x);
       int tagbits = (int)obj & 0x7;
@@ -1450,221 +2195,221 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
         F_JUMP(*p == tag);
       }else{
         pc = pc0 + (n2 * 4);
-        continue;
+        NEXT();
       }
     }
-    case GOTO_OPCODE : {
+    VM_CASE(GOTO_OPCODE) {
       DECODE_A_SIGNED();
       pc = pc0 + (value * 4);
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_BYTE_FLOAT : {
+    VM_CASE(CONV_OPCODE_BYTE_FLOAT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (uint8_t)(LOCAL_FLOAT(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_BYTE_DOUBLE : {
+    VM_CASE(CONV_OPCODE_BYTE_DOUBLE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (uint8_t)(LOCAL_DOUBLE(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_INT_BYTE : {
+    VM_CASE(CONV_OPCODE_INT_BYTE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int32_t)(uint8_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_INT_FLOAT : {
+    VM_CASE(CONV_OPCODE_INT_FLOAT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int32_t)(LOCAL_FLOAT(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_INT_DOUBLE : {
+    VM_CASE(CONV_OPCODE_INT_DOUBLE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int32_t)(LOCAL_DOUBLE(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_LONG_BYTE : {
+    VM_CASE(CONV_OPCODE_LONG_BYTE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int64_t)(uint8_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_LONG_INT : {
+    VM_CASE(CONV_OPCODE_LONG_INT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int64_t)(int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_LONG_FLOAT : {
+    VM_CASE(CONV_OPCODE_LONG_FLOAT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int64_t)(LOCAL_FLOAT(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_LONG_DOUBLE : {
+    VM_CASE(CONV_OPCODE_LONG_DOUBLE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, (int64_t)(LOCAL_DOUBLE(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_FLOAT_BYTE : {
+    VM_CASE(CONV_OPCODE_FLOAT_BYTE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_FLOAT(x, (uint8_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_FLOAT_INT : {
+    VM_CASE(CONV_OPCODE_FLOAT_INT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_FLOAT(x, (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_FLOAT_LONG : {
+    VM_CASE(CONV_OPCODE_FLOAT_LONG) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_FLOAT(x, (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_FLOAT_DOUBLE : {
+    VM_CASE(CONV_OPCODE_FLOAT_DOUBLE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_FLOAT(x, LOCAL_DOUBLE(value));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_DOUBLE_BYTE : {
+    VM_CASE(CONV_OPCODE_DOUBLE_BYTE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_DOUBLE(x, (uint8_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_DOUBLE_INT : {
+    VM_CASE(CONV_OPCODE_DOUBLE_INT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_DOUBLE(x, (int32_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_DOUBLE_LONG : {
+    VM_CASE(CONV_OPCODE_DOUBLE_LONG) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_DOUBLE(x, (int64_t)(LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case CONV_OPCODE_DOUBLE_FLOAT : {
+    VM_CASE(CONV_OPCODE_DOUBLE_FLOAT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL_DOUBLE(x, LOCAL_FLOAT(value));
-      continue;
+      NEXT();
     }
-    case DETAG_OPCODE : {
+    VM_CASE(DETAG_OPCODE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, LOCAL(value) >> 32L);
-      continue;
+      NEXT();
     }
-    case TAG_OPCODE_BYTE : {
+    VM_CASE(TAG_OPCODE_BYTE) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ((uint64_t)(uint8_t)(LOCAL(value)) << 32L) + BYTE_TAG_BITS);
-      continue;
+      NEXT();
     }
-    case TAG_OPCODE_CHAR : {
+    VM_CASE(TAG_OPCODE_CHAR) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ((uint64_t)(uint8_t)(LOCAL(value)) << 32L) + CHAR_TAG_BITS);
-      continue;
+      NEXT();
     }
-    case TAG_OPCODE_INT : {
+    VM_CASE(TAG_OPCODE_INT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ((uint64_t)LOCAL(value) << 32L) + INT_TAG_BITS);
-      continue;
+      NEXT();
     }
-    case TAG_OPCODE_FLOAT : {
+    VM_CASE(TAG_OPCODE_FLOAT) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, ((uint64_t)LOCAL(value) << 32L) + FLOAT_TAG_BITS);
-      continue;
+      NEXT();
     }
-    case STORE_OPCODE_1 : {
+    VM_CASE(STORE_OPCODE_1) {
       DECODE_E();
       char* address = (char*)(LOCAL(x) + value);
       char storeval = (char)(LOCAL(z));
       *address = storeval;
-      continue;
+      NEXT();
     }
-    case STORE_OPCODE_4 : {
+    VM_CASE(STORE_OPCODE_4) {
       DECODE_E();
       int32_t* address = (int32_t*)(LOCAL(x) + value);
       int32_t storeval = (int32_t)(LOCAL(z));
       *address = storeval;
-      continue;
+      NEXT();
     }
-    case STORE_OPCODE_8 : {
+    VM_CASE(STORE_OPCODE_8) {
       DECODE_E();
       int64_t* address = (int64_t*)(LOCAL(x) + value);
       int64_t storeval = (int64_t)(LOCAL(z));
       *address = storeval;
-      continue;
+      NEXT();
     }
-    case STORE_OPCODE_1_VAR_OFFSET : {
+    VM_CASE(STORE_OPCODE_1_VAR_OFFSET) {
       DECODE_E();
       char* address = (char*)(LOCAL(x) + LOCAL(y) + value);
       char storeval = (char)(LOCAL(z));
       *address = storeval;
-      continue;
+      NEXT();
     }
-    case STORE_OPCODE_4_VAR_OFFSET : {
+    VM_CASE(STORE_OPCODE_4_VAR_OFFSET) {
       DECODE_E();
       int32_t* address = (int32_t*)(LOCAL(x) + LOCAL(y) + value);
       int32_t storeval = (int32_t)(LOCAL(z));
       *address = storeval;
-      continue;
+      NEXT();
     }
-    case STORE_OPCODE_8_VAR_OFFSET : {
+    VM_CASE(STORE_OPCODE_8_VAR_OFFSET) {
       DECODE_E();
       int64_t* address = (int64_t*)(LOCAL(x) + LOCAL(y) + value);
       int64_t storeval = (int64_t)(LOCAL(z));
       *address = storeval;
-      continue;
+      NEXT();
     }
-    case STORE_WITH_BARRIER_OPCODE : {
+    VM_CASE(STORE_WITH_BARRIER_OPCODE) {
       DECODE_E();
 
       //Retrieve address to store to and value to store.
       uint64_t* address = (uint64_t*)(LOCAL(x) + value);
       uint64_t val = (uint64_t)(LOCAL(z));
       barriered_store(vms, address, val);
-      continue;
+      NEXT();
     }
-    case STORE_WITH_BARRIER_OPCODE_VAR_OFFSET : {
+    VM_CASE(STORE_WITH_BARRIER_OPCODE_VAR_OFFSET) {
       DECODE_E();
 
       //Retrieve address to store to and value to store.
       uint64_t* address = (uint64_t*)(LOCAL(x) + LOCAL(y) + value);
       uint64_t val = (uint64_t)(LOCAL(z));
       barriered_store(vms, address, val);
-      continue;
+      NEXT();
     }
-    case LOAD_OPCODE_1 : {
+    VM_CASE(LOAD_OPCODE_1) {
       DECODE_E();
       char* address = (char*)(LOCAL(y) + value);
       SET_LOCAL(x, *address);
-      continue;
+      NEXT();
     }
-    case LOAD_OPCODE_4 : {
+    VM_CASE(LOAD_OPCODE_4) {
       DECODE_E();
       int32_t* address = (int32_t*)(LOCAL(y) + value);
       SET_LOCAL(x, *address);
-      continue;
+      NEXT();
     }
-    case LOAD_OPCODE_8 : {
+    VM_CASE(LOAD_OPCODE_8) {
       DECODE_E();
       int64_t* address = (int64_t*)(LOCAL(y) + value);
       SET_LOCAL(x, *address);
-      continue;
+      NEXT();
     }
-    case LOAD_OPCODE_1_VAR_OFFSET : {
+    VM_CASE(LOAD_OPCODE_1_VAR_OFFSET) {
       DECODE_E();
       char* address = (char*)(LOCAL(y) + LOCAL(z) + value);
       SET_LOCAL(x, *address);
-      continue;
+      NEXT();
     }
-    case LOAD_OPCODE_4_VAR_OFFSET : {
+    VM_CASE(LOAD_OPCODE_4_VAR_OFFSET) {
       DECODE_E();
       int32_t* address = (int32_t*)(LOCAL(y) + LOCAL(z) + value);
       SET_LOCAL(x, *address);
-      continue;
+      NEXT();
     }
-    case LOAD_OPCODE_8_VAR_OFFSET : {
+    VM_CASE(LOAD_OPCODE_8_VAR_OFFSET) {
       DECODE_E();
       int64_t* address = (int64_t*)(LOCAL(y) + LOCAL(z) + value);
       SET_LOCAL(x, *address);
-      continue;
+      NEXT();
     }
-    case RESERVE_OPCODE_LOCAL : {
+    VM_CASE(RESERVE_OPCODE_LOCAL) {
       DECODE_C();
       uint64_t size = 8 + LOCAL(value);
       size = (size + 7) & -8;
@@ -1672,7 +2417,7 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
       int offset = x * 4;
       if(heap_top + size <= heap_limit){
         pc = pc0 + offset;
-        continue;
+        NEXT();
       }else{
         SET_REG(0, BOOLREF(0));
         SET_REG(1, 1L);
@@ -1680,17 +2425,17 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
         uint64_t fpos = (uint64_t)(code_offsets[EXTEND_HEAP_FN]) * 4;
         PUSH_FRAME(num_locals);
         pc = instructions + fpos;
-        continue;
+        NEXT();
       }
     }
-    case RESERVE_OPCODE_CONST : {
+    VM_CASE(RESERVE_OPCODE_CONST) {
       DECODE_C();
       uint64_t size = value;
       int num_locals = y;
       int offset = x * 4;
       if(heap_top + size <= heap_limit){
         pc = pc0 + offset;
-        continue;
+        NEXT();
       }else{
         SET_REG(0, BOOLREF(0));
         SET_REG(1, 1L);
@@ -1698,10 +2443,10 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
         uint64_t fpos = (uint64_t)(code_offsets[EXTEND_HEAP_FN]) * 4;
         PUSH_FRAME(num_locals);
         pc = instructions + fpos;
-        continue;
+        NEXT();
       }
     }
-    case ALLOC_OPCODE_CONST : {
+    VM_CASE(ALLOC_OPCODE_CONST) {
       DECODE_C();
       int num_bytes = 8 + y;
       int type = value;
@@ -1709,9 +2454,9 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
       uint64_t obj = ptr_to_ref(heap_top);
       SET_LOCAL(x, obj);
       heap_top = heap_top + num_bytes;
-      continue;
+      NEXT();
     }
-    case ALLOC_OPCODE_LOCAL : {
+    VM_CASE(ALLOC_OPCODE_LOCAL) {
       DECODE_C();
       uint64_t num_bytes = 8 + LOCAL(y);
       num_bytes = (num_bytes + 7) & -8;
@@ -1720,249 +2465,251 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
       uint64_t obj = ptr_to_ref(heap_top);
       SET_LOCAL(x, obj);
       heap_top = heap_top + num_bytes;
-      continue;
+      NEXT();
     }
-    case GC_OPCODE : {
+    VM_CASE(GC_OPCODE) {
       DECODE_B_UNSIGNED();
       //Size to extend
       uint64_t size = LOCAL(value);
       //Call GC
       SAVE_STATE();
+      PROFILE_START();
       int64_t remaining = call_garbage_collector(vms, size);
+      PROFILE_END(gc_time, num_gcs);
       RESTORE_STATE();
       //Return heap remaining
       SET_LOCAL(x, remaining);
-      continue;
+      NEXT();
     }
-    case PRINT_STACK_TRACE_OPCODE : {
+    VM_CASE(PRINT_STACK_TRACE_OPCODE) {
       DECODE_B_UNSIGNED();
       uint64_t stack = LOCAL(value);
       call_print_stack_trace(vms, stack);
       SET_LOCAL(x, 0);
-      continue;
+      NEXT();
     }
-    case COLLECT_STACK_TRACE_OPCODE : {
+    VM_CASE(COLLECT_STACK_TRACE_OPCODE) {
       DECODE_B_UNSIGNED();
       uint64_t stack = LOCAL(value);
       void* packed_trace = call_collect_stack_trace(vms, stack);
       SET_LOCAL(x, (uint64_t)packed_trace);
-      continue;
+      NEXT();
     }
-    case FLUSH_VM_OPCODE : {
+    VM_CASE(FLUSH_VM_OPCODE) {
       DECODE_A_UNSIGNED();
       SAVE_STATE();
       SET_LOCAL(value, (uint64_t)vms);
-      continue;
+      NEXT();
     }
-    case C_RSP_OPCODE : {
+    VM_CASE(C_RSP_OPCODE) {
       DECODE_A_UNSIGNED();
       SET_LOCAL(value, stanza_crsp);
-      continue;
+      NEXT();
     }
-    case JUMP_INT_LT_OPCODE : {
+    VM_CASE(JUMP_INT_LT_OPCODE) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) < (int64_t)LOCAL(y));
     }
-    case JUMP_INT_GT_OPCODE : {
+    VM_CASE(JUMP_INT_GT_OPCODE) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) > (int64_t)LOCAL(y));
     }
-    case JUMP_INT_LE_OPCODE : {
+    VM_CASE(JUMP_INT_LE_OPCODE) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) <= (int64_t)LOCAL(y));
     }
-    case JUMP_INT_GE_OPCODE : {
+    VM_CASE(JUMP_INT_GE_OPCODE) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) >= (int64_t)LOCAL(y));
     }
-    case JUMP_EQ_OPCODE_REF : {
+    VM_CASE(JUMP_EQ_OPCODE_REF) {
       DECODE_F();
       F_JUMP(LOCAL(x) == LOCAL(y));
     }
-    case JUMP_EQ_OPCODE_BYTE : {
+    VM_CASE(JUMP_EQ_OPCODE_BYTE) {
       DECODE_F();
       F_JUMP((int8_t)LOCAL(x) == (int8_t)LOCAL(y));
     }
-    case JUMP_EQ_OPCODE_INT : {
+    VM_CASE(JUMP_EQ_OPCODE_INT) {
       DECODE_F();
       F_JUMP((int32_t)LOCAL(x) == (int32_t)LOCAL(y));
     }
-    case JUMP_EQ_OPCODE_LONG : {
+    VM_CASE(JUMP_EQ_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) == (int64_t)LOCAL(y));
     }
-    case JUMP_EQ_OPCODE_FLOAT : {
+    VM_CASE(JUMP_EQ_OPCODE_FLOAT) {
       DECODE_F();
       F_JUMP(LOCAL_FLOAT(x) == LOCAL_FLOAT(y));
     }
-    case JUMP_EQ_OPCODE_DOUBLE : {
+    VM_CASE(JUMP_EQ_OPCODE_DOUBLE) {
       DECODE_F();
       F_JUMP(LOCAL_DOUBLE(x) == LOCAL_DOUBLE(y));
     }
-    case JUMP_NE_OPCODE_REF : {
+    VM_CASE(JUMP_NE_OPCODE_REF) {
       DECODE_F();
       F_JUMP(LOCAL(x) != LOCAL(y));
     }
-    case JUMP_NE_OPCODE_BYTE : {
+    VM_CASE(JUMP_NE_OPCODE_BYTE) {
       DECODE_F();
       F_JUMP((int8_t)LOCAL(x) != (int8_t)LOCAL(y));
     }
-    case JUMP_NE_OPCODE_INT : {
+    VM_CASE(JUMP_NE_OPCODE_INT) {
       DECODE_F();
       F_JUMP((int32_t)LOCAL(x) != (int32_t)LOCAL(y));
     }
-    case JUMP_NE_OPCODE_LONG : {
+    VM_CASE(JUMP_NE_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) != (int64_t)LOCAL(y));
     }
-    case JUMP_NE_OPCODE_FLOAT : {
+    VM_CASE(JUMP_NE_OPCODE_FLOAT) {
       DECODE_F();
       F_JUMP(LOCAL_FLOAT(x) != LOCAL_FLOAT(y));
     }
-    case JUMP_NE_OPCODE_DOUBLE : {
+    VM_CASE(JUMP_NE_OPCODE_DOUBLE) {
       DECODE_F();
       F_JUMP(LOCAL_DOUBLE(x) != LOCAL_DOUBLE(y));
     }
-    case JUMP_LT_OPCODE_INT : {
+    VM_CASE(JUMP_LT_OPCODE_INT) {
       DECODE_F();
       F_JUMP((int32_t)LOCAL(x) < (int32_t)LOCAL(y));
     }
-    case JUMP_LT_OPCODE_LONG : {
+    VM_CASE(JUMP_LT_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) < (int64_t)LOCAL(y));
     }
-    case JUMP_LT_OPCODE_FLOAT : {
+    VM_CASE(JUMP_LT_OPCODE_FLOAT) {
       DECODE_F();
       F_JUMP(LOCAL_FLOAT(x) < LOCAL_FLOAT(y));
     }
-    case JUMP_LT_OPCODE_DOUBLE : {
+    VM_CASE(JUMP_LT_OPCODE_DOUBLE) {
       DECODE_F();
       F_JUMP(LOCAL_DOUBLE(x) < LOCAL_DOUBLE(y));
     }
-    case JUMP_GT_OPCODE_INT : {
+    VM_CASE(JUMP_GT_OPCODE_INT) {
       DECODE_F();
       F_JUMP((int32_t)LOCAL(x) > (int32_t)LOCAL(y));
     }
-    case JUMP_GT_OPCODE_LONG : {
+    VM_CASE(JUMP_GT_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) > (int64_t)LOCAL(y));
     }
-    case JUMP_GT_OPCODE_FLOAT : {
+    VM_CASE(JUMP_GT_OPCODE_FLOAT) {
       DECODE_F();
       F_JUMP(LOCAL_FLOAT(x) > LOCAL_FLOAT(y));
     }
-    case JUMP_GT_OPCODE_DOUBLE : {
+    VM_CASE(JUMP_GT_OPCODE_DOUBLE) {
       DECODE_F();
       F_JUMP(LOCAL_DOUBLE(x) > LOCAL_DOUBLE(y));
     }
-    case JUMP_LE_OPCODE_INT : {
+    VM_CASE(JUMP_LE_OPCODE_INT) {
       DECODE_F();
       F_JUMP((int32_t)LOCAL(x) <= (int32_t)LOCAL(y));
     }
-    case JUMP_LE_OPCODE_LONG : {
+    VM_CASE(JUMP_LE_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) <= (int64_t)LOCAL(y));
     }
-    case JUMP_LE_OPCODE_FLOAT : {
+    VM_CASE(JUMP_LE_OPCODE_FLOAT) {
       DECODE_F();
       F_JUMP(LOCAL_FLOAT(x) <= LOCAL_FLOAT(y));
     }
-    case JUMP_LE_OPCODE_DOUBLE : {
+    VM_CASE(JUMP_LE_OPCODE_DOUBLE) {
       DECODE_F();
       F_JUMP(LOCAL_DOUBLE(x) <= LOCAL_DOUBLE(y));
     }
-    case JUMP_GE_OPCODE_INT : {
+    VM_CASE(JUMP_GE_OPCODE_INT) {
       DECODE_F();
       F_JUMP((int32_t)LOCAL(x) >= (int32_t)LOCAL(y));
     }
-    case JUMP_GE_OPCODE_LONG : {
+    VM_CASE(JUMP_GE_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((int64_t)LOCAL(x) >= (int64_t)LOCAL(y));
     }
-    case JUMP_GE_OPCODE_FLOAT : {
+    VM_CASE(JUMP_GE_OPCODE_FLOAT) {
       DECODE_F();
       F_JUMP(LOCAL_FLOAT(x) >= LOCAL_FLOAT(y));
     }
-    case JUMP_GE_OPCODE_DOUBLE : {
+    VM_CASE(JUMP_GE_OPCODE_DOUBLE) {
       DECODE_F();
       F_JUMP(LOCAL_DOUBLE(x) >= LOCAL_DOUBLE(y));
     }
-    case JUMP_ULE_OPCODE_BYTE : {
+    VM_CASE(JUMP_ULE_OPCODE_BYTE) {
       DECODE_F();
       F_JUMP((uint8_t)LOCAL(x) <= (uint8_t)LOCAL(y));
     }
-    case JUMP_ULE_OPCODE_INT : {
+    VM_CASE(JUMP_ULE_OPCODE_INT) {
       DECODE_F();
       F_JUMP((uint32_t)LOCAL(x) <= (uint32_t)LOCAL(y));
     }
-    case JUMP_ULE_OPCODE_LONG : {
+    VM_CASE(JUMP_ULE_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((uint64_t)LOCAL(x) <= (uint64_t)LOCAL(y));
     }
-    case JUMP_ULT_OPCODE_BYTE : {
+    VM_CASE(JUMP_ULT_OPCODE_BYTE) {
       DECODE_F();
       F_JUMP((uint8_t)LOCAL(x) < (uint8_t)LOCAL(y));
     }
-    case JUMP_ULT_OPCODE_INT : {
+    VM_CASE(JUMP_ULT_OPCODE_INT) {
       DECODE_F();
       F_JUMP((uint32_t)LOCAL(x) < (uint32_t)LOCAL(y));
     }
-    case JUMP_ULT_OPCODE_LONG : {
+    VM_CASE(JUMP_ULT_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((uint64_t)LOCAL(x) < (uint64_t)LOCAL(y));
     }
-    case JUMP_UGE_OPCODE_BYTE : {
+    VM_CASE(JUMP_UGE_OPCODE_BYTE) {
       DECODE_F();
       F_JUMP((uint8_t)LOCAL(x) >= (uint8_t)LOCAL(y));
     }
-    case JUMP_UGE_OPCODE_INT : {
+    VM_CASE(JUMP_UGE_OPCODE_INT) {
       DECODE_F();
       F_JUMP((uint32_t)LOCAL(x) >= (uint32_t)LOCAL(y));
     }
-    case JUMP_UGE_OPCODE_LONG : {
+    VM_CASE(JUMP_UGE_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((uint64_t)LOCAL(x) >= (uint64_t)LOCAL(y));
     }
-    case JUMP_UGT_OPCODE_BYTE : {
+    VM_CASE(JUMP_UGT_OPCODE_BYTE) {
       DECODE_F();
       F_JUMP((uint8_t)LOCAL(x) > (uint8_t)LOCAL(y));
     }
-    case JUMP_UGT_OPCODE_INT : {
+    VM_CASE(JUMP_UGT_OPCODE_INT) {
       DECODE_F();
       F_JUMP((uint32_t)LOCAL(x) > (uint32_t)LOCAL(y));
     }
-    case JUMP_UGT_OPCODE_LONG : {
+    VM_CASE(JUMP_UGT_OPCODE_LONG) {
       DECODE_F();
       F_JUMP((uint64_t)LOCAL(x) > (uint64_t)LOCAL(y));
     }
-    case DISPATCH_OPCODE : {
+    VM_CASE(DISPATCH_OPCODE) {
       DECODE_A_UNSIGNED();
       uint32_t* tgts = (uint32_t*)(pc + 4);
       //DECODE_TGTS();
       int format = value;
-      int index = read_dispatch_table(vms, format);
+      int index = read_cached_dispatch_table(vms, pc0 - instructions, format);
       int tgt = tgts[index];
       pc = pc0 + (tgt * 4);
-      continue;
+      NEXT();
     }
-    case DISPATCH_METHOD_OPCODE : {
+    VM_CASE(DISPATCH_METHOD_OPCODE) {
       DECODE_A_UNSIGNED();
       uint32_t* tgts = (uint32_t*)(pc + 4);
       //DECODE_TGTS();
       int format = value;
-      int index = read_dispatch_table(vms, format);
+      int index = read_cached_dispatch_table(vms, pc0 - instructions, format);
       if(index < 2){
         int tgt = tgts[index];
         pc = pc0 + (tgt * 4);
-        continue;
+        NEXT();
       }else{
         int fid = index - 2;
         uint64_t fpos = (uint64_t)(code_offsets[fid]) * 4;
         pc = instructions + fpos;
-        continue;
+        NEXT();
       }
     }
-    case JUMP_REG_OPCODE : {
+    VM_CASE(JUMP_REG_OPCODE) {
       DECODE_C();
       int reg = x;
       uint64_t arity = y;
@@ -1970,9 +2717,9 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
       if(registers[reg] == arity){
         pc = pc0 + offset;
       }
-      continue;
+      NEXT();
     }
-    case FNENTRY_OPCODE : {
+    VM_CASE(FNENTRY_OPCODE) {
       DECODE_A_UNSIGNED();
       int frame_size = value * 8 + sizeof(StackFrame);
       int size_required = frame_size + sizeof(StackFrame);
@@ -2001,51 +2748,84 @@ void vmloop (VMState* vms, uint64_t stanza_crsp){
         uint64_t fpos = (uint64_t)(code_offsets[EXTEND_STACK_FN]) * 4;
         pc = instructions + fpos;
       }
-      continue;
+      NEXT();
     }
-    case LOWEST_ZERO_BIT_COUNT_OPCODE_LONG : {
+    VM_CASE(LOWEST_ZERO_BIT_COUNT_OPCODE_LONG) {
       DECODE_B_UNSIGNED();
       SET_LOCAL(x, lowest_zero_bit_count((uint64_t)LOCAL(value)));
-      continue;
+      NEXT();
     }
-    case SET_BIT_OPCODE : {
+    VM_CASE(SET_BIT_OPCODE) {
       DECODE_C();
       uint64_t bit_index = (uint64_t)LOCAL(y);
       uint64_t* bitset_base = (uint64_t*)LOCAL(value);
       set_bit(bit_index, bitset_base);
-      continue;
+      NEXT();
     }
-    case CLEAR_BIT_OPCODE : {
+    VM_CASE(CLEAR_BIT_OPCODE) {
       DECODE_C();
       uint64_t bit_index = (uint64_t)LOCAL(y);
       uint64_t* bitset_base = (uint64_t*)LOCAL(value);
       clear_bit(bit_index, bitset_base);
-      continue;
+      NEXT();
     }
-    case TEST_BIT_OPCODE : {
+    VM_CASE(TEST_BIT_OPCODE) {
       DECODE_C();
       uint64_t bit_index = (uint64_t)LOCAL(y);
       uint64_t* bitset_base = (uint64_t*)LOCAL(value);
       SET_LOCAL(x, test_bit(bit_index, bitset_base));
-      continue;
+      NEXT();
     }
-    case TEST_AND_SET_BIT_OPCODE : {
+    VM_CASE(TEST_AND_SET_BIT_OPCODE) {
       DECODE_C();
       uint64_t bit_index = (uint64_t)LOCAL(y);
       uint64_t* bitset_base = (uint64_t*)LOCAL(value);
       SET_LOCAL(x, test_and_set_bit(bit_index, bitset_base));
-      continue;
+      NEXT();
     }
-    case TEST_AND_CLEAR_BIT_OPCODE : {
+    VM_CASE(TEST_AND_CLEAR_BIT_OPCODE) {
       DECODE_C();
       uint64_t bit_index = (uint64_t)LOCAL(y);
       uint64_t* bitset_base = (uint64_t*)LOCAL(value);
       SET_LOCAL(x, test_and_clear_bit(bit_index, bitset_base));
-      continue;
+      NEXT();
+    }
+    //Superinstructions
+    VM_CASE(JUMP_EQ_OPCODE_CONST) {
+      DECODE_F();
+      uint64_t value = (uint64_t)PC_INT();
+      F_JUMP(LOCAL(x) == value);
+    }
+    VM_CASE(JUMP_NE_OPCODE_CONST) {
+      DECODE_F();
+      uint64_t value = (uint64_t)PC_INT();
+      F_JUMP(LOCAL(x) != value);
+    }
+    VM_CASE(POP_FRAME_GET_REG_OPCODE) {
+      DECODE_B_UNSIGNED();
+      int num_locals = value;
+      POP_FRAME(num_locals);
+      SET_LOCAL(x, registers[0]);
+      NEXT();
+    }
+    VM_CASE(SET_REG_OPCODE_LOCAL_2) {
+      DECODE_C();
+      SET_REG(x, LOCAL(y));
+      SET_REG(x + 1, LOCAL(value));
+      NEXT();
+    }
+    VM_CASE(GET_REG_OPCODE_2) {
+      DECODE_C();
+      SET_LOCAL(x, registers[value]);
+      SET_LOCAL(y, registers[value + 1]);
+      NEXT();
     }
     }
 
     //Done
+#ifdef VM_THREADED_DISPATCH
+  INVALID_OPCODE_LABEL:
+#endif
     printf("Invalid opcode: %d\n", opcode);
     exit(-1);
   }
@@ -2131,9 +2911,8 @@ int dhash (int d, int x, int n){
   return ((int)a & 0x7FFFFFFF) % n;
 }
 
-int lookup_trie_table (VMState* vms, TrieTable* trie_table){
+int lookup_trie_table_type (TrieTable* trie_table, int type){
   int n = trie_table->n;
-  int type = argtype(vms, trie_table->index);
   if(n <= 4){
     return lookup_small_etable(small_etable(trie_table), type, n);
   }else{
@@ -2149,6 +2928,11 @@ int lookup_trie_table (VMState* vms, TrieTable* trie_table){
   }
 }
 
+int lookup_trie_table (VMState* vms, TrieTable* trie_table){
+  int type = argtype(vms, trie_table->index);
+  return lookup_trie_table_type(trie_table, type);
+}
+
 int read_dispatch_table (VMState* vms, int format){
   int* trie_table = vms->trie_table[format];
   int table_offset = 0;
@@ -2158,3 +2942,89 @@ int read_dispatch_table (VMState* vms, int format){
     table_offset = value;
   }
 }
+
+//============================================================
+//===================== Dispatch Cache =======================
+//============================================================
+
+//Each DISPATCH, DISPATCH_METHOD and TYPEOF instruction caches
+//the results of its most recent lookups. An entry records the
+//argument types examined along the path through the trie table,
+//and is reused when those arguments have the same types again.
+//Up to DISPATCH_CACHE_WAYS entries are kept per instruction. The
+//cache is invalidated whenever the trie tables are updated.
+
+#define DISPATCH_CACHE_LINES 1024
+#define DISPATCH_CACHE_WAYS 4
+#define DISPATCH_CACHE_DEPTH 4
+
+typedef struct {
+  int num_args;     //0 if the entry is empty
+  int result;
+  int args[DISPATCH_CACHE_DEPTH];
+  int types[DISPATCH_CACHE_DEPTH];
+} DispatchCacheEntry;
+
+typedef struct {
+  uint64_t epoch;
+  uint32_t site;    //Position of the dispatch instruction
+  int next_way;     //Entry to replace on the next miss
+  DispatchCacheEntry entries[DISPATCH_CACHE_WAYS];
+} DispatchCacheLine;
+
+static DispatchCacheLine dispatch_cache[DISPATCH_CACHE_LINES];
+static uint64_t dispatch_cache_epoch = 1;
+
+void invalidate_dispatch_cache (void){
+  dispatch_cache_epoch++;
+}
+
+int read_cached_dispatch_table (VMState* vms, uint32_t site, int format){
+  DispatchCacheLine* line = &dispatch_cache[(site >> 2) & (DISPATCH_CACHE_LINES - 1)];
+  if(line->epoch != dispatch_cache_epoch || line->site != site){
+    //Claim the line for this site
+    line->epoch = dispatch_cache_epoch;
+    line->site = site;
+    line->next_way = 0;
+    for(int i=0; i<DISPATCH_CACHE_WAYS; i++)
+      line->entries[i].num_args = 0;
+  }else{
+    //Look for an entry whose argument types all match
+    for(int i=0; i<DISPATCH_CACHE_WAYS; i++){
+      DispatchCacheEntry* e = &line->entries[i];
+      if(e->num_args == 0) break;
+      int j = 0;
+      while(j < e->num_args && argtype(vms, e->args[j]) == e->types[j]) j++;
+      if(j == e->num_args) return e->result;
+    }
+  }
+
+  //Walk the trie table and record the path taken
+  DispatchCacheEntry entry;
+  int* trie_table = vms->trie_table[format];
+  int table_offset = 0;
+  int depth = 0;
+  while(1){
+    TrieTable* table = (TrieTable*)(trie_table + table_offset);
+    int type = argtype(vms, table->index);
+    if(depth < DISPATCH_CACHE_DEPTH){
+      entry.args[depth] = table->index;
+      entry.types[depth] = type;
+    }
+    depth++;
+    int value = lookup_trie_table_type(table, type);
+    if(value < 0){
+      entry.result = -value - 1;
+      break;
+    }
+    table_offset = value;
+  }
+
+  //Paths longer than DISPATCH_CACHE_DEPTH are not cached
+  if(depth <= DISPATCH_CACHE_DEPTH){
+    entry.num_args = depth;
+    line->entries[line->next_way] = entry;
+    line->next_way = (line->next_way + 1) % DISPATCH_CACHE_WAYS;
+  }
+  return entry.result;
+}
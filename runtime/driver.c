@@ -562,6 +562,97 @@ void stz_memory_resize (void* p, stz_long old_size, stz_long new_size) {
 
 #endif
 
+//============================================================
+//================= Stanza File Mapping ======================
+//============================================================
+
+//Empty files cannot be mapped, so they are represented
+//by a pointer to this byte instead.
+static char empty_file_mapping;
+
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_OS_X)
+
+//Maps the whole file with the given name into memory, and stores
+//its size in size_out. The mapping is shared, so writes to a writable
+//mapping are written back to the file.
+//Returns NULL and sets errno if the file cannot be mapped.
+stz_byte* stz_file_map (const stz_byte* filename, stz_int writable, stz_long* size_out) {
+  int fd = open(C_CSTR(filename), writable ? O_RDWR : O_RDONLY);
+  if(fd < 0) return NULL;
+  struct stat st;
+  if(fstat(fd, &st) != 0){
+    int err = errno;
+    close(fd);
+    errno = err;
+    return NULL;
+  }
+  *size_out = (stz_long)st.st_size;
+  if(st.st_size == 0){
+    close(fd);
+    return (stz_byte*)&empty_file_mapping;
+  }
+  int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void* p = mmap(NULL, (size_t)st.st_size, prot, MAP_SHARED, fd, 0);
+  int err = errno;
+  close(fd);
+  if(p == MAP_FAILED){
+    errno = err;
+    return NULL;
+  }
+  return (stz_byte*)p;
+}
+
+stz_int stz_file_unmap (stz_byte* p, stz_long size) {
+  if(size == 0) return 0;
+  return (stz_int)munmap(p, (size_t)size);
+}
+
+stz_int stz_file_sync (stz_byte* p, stz_long size) {
+  if(size == 0) return 0;
+  return (stz_int)msync(p, (size_t)size, MS_SYNC);
+}
+
+#endif
+
+#ifdef PLATFORM_WINDOWS
+
+//Maps the whole file with the given name into memory, and stores
+//its size in size_out. Returns NULL if the file cannot be mapped.
+stz_byte* stz_file_map (const stz_byte* filename, stz_int writable, stz_long* size_out) {
+  DWORD access = writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+  HANDLE file = CreateFile(C_CSTR(filename), access, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                           NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(file == INVALID_HANDLE_VALUE) return NULL;
+  LARGE_INTEGER size;
+  if(!GetFileSizeEx(file, &size)){
+    CloseHandle(file);
+    return NULL;
+  }
+  *size_out = (stz_long)size.QuadPart;
+  if(size.QuadPart == 0){
+    CloseHandle(file);
+    return (stz_byte*)&empty_file_mapping;
+  }
+  HANDLE mapping = CreateFileMapping(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if(mapping == NULL) return NULL;
+  void* p = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  return (stz_byte*)p;
+}
+
+stz_int stz_file_unmap (stz_byte* p, stz_long size) {
+  if(size == 0) return 0;
+  return UnmapViewOfFile(p) ? 0 : -1;
+}
+
+stz_int stz_file_sync (stz_byte* p, stz_long size) {
+  if(size == 0) return 0;
+  return FlushViewOfFile(p, (SIZE_T)size) ? 0 : -1;
+}
+
+#endif
+
 //============================================================
 //================= Process Runtime ==========================
 //============================================================
@@ -1083,19 +1174,74 @@ static stz_long bitset_size (stz_long heap_size) {
   return ROUND_UP_TO_WHOLE_PAGES(bitset_size_in_longs << LOG_BYTES_IN_LONG);
 }
 
+//Largest size in bytes accepted from the environment. Sizes are
+//rounded up to whole pages, which must not overflow.
+#define MAX_ENV_SIZE (INT64_MAX - (stz_long)(SYSTEM_PAGE_SIZE - 1))
+
+//Read a positive integer, no larger than max_value, from the given
+//environment variable. If suffix is true, the integer is a size in
+//bytes and may have a K, M, or G suffix. Returns default_value if the
+//variable is not set, and exits if it is malformed or out of range.
+static stz_long env_long (const char* name, stz_long default_value, stz_long max_value, bool suffix) {
+  const char* value = getenv(name);
+  if(value == NULL || *value == 0) return default_value;
+  char* end;
+  errno = 0;
+  long long n = strtoll(value, &end, 10);
+  int shift = 0;
+  if(suffix){
+    switch(*end){
+    case 'k': case 'K': shift = 10; end++; break;
+    case 'm': case 'M': shift = 20; end++; break;
+    case 'g': case 'G': shift = 30; end++; break;
+    }
+  }
+  //Range-check before shifting so that the shift cannot overflow.
+  if(end == value || *end != 0 || errno == ERANGE || n <= 0 || n > (max_value >> shift)){
+    fprintf(stderr, "Invalid value for %s: %s.\n", name, value);
+    exit(-1);
+  }
+  return (stz_long)(n << shift);
+}
+
+//Read a size in bytes, with an optional K, M, or G suffix.
+static stz_long env_size (const char* name, stz_long default_size) {
+  return env_long(name, default_size, MAX_ENV_SIZE, true);
+}
+
 STANZA_API_FUNC int main (int argc, char* argv[]) {
   input_argc = (stz_int)argc;
   input_argv = (stz_byte **)argv;
   input_argv_needs_free = 0;
   VMInit init;
 
+  //Read heap configuration
+  //- STANZA_HEAP_SIZE: initial size of the heap.
+  //- STANZA_MAX_HEAP_SIZE: maximum size the heap can grow to.
+  //- STANZA_NURSERY_SIZE: initial size of the young generation.
+  //- STANZA_MARKING_STACK_SIZE: number of entries in the GC marking stack.
+  const stz_long min_heap_size = ROUND_UP_TO_WHOLE_PAGES(env_size("STANZA_HEAP_SIZE", 8 * 1024 * 1024));
+  const stz_long max_heap_size = ROUND_UP_TO_WHOLE_PAGES(env_size("STANZA_MAX_HEAP_SIZE", STZ_LONG(8) * 1024 * 1024 * 1024));
+  const stz_long young_gen_size = env_size("STANZA_NURSERY_SIZE", 2 * 1024 * 1024) & ~(BYTES_IN_LONG - 1);
+  const stz_long marking_stack_entries = env_long("STANZA_MARKING_STACK_SIZE", 1024 * 1024L,
+                                                  MAX_ENV_SIZE >> LOG_BYTES_IN_LONG, false);
+  if(max_heap_size < min_heap_size){
+    fprintf(stderr, "STANZA_MAX_HEAP_SIZE must not be smaller than STANZA_HEAP_SIZE.\n");
+    exit(-1);
+  }
+  if(young_gen_size <= 0){
+    fprintf(stderr, "STANZA_NURSERY_SIZE must be at least %d bytes.\n", BYTES_IN_LONG);
+    exit(-1);
+  }
+  if(young_gen_size > min_heap_size){
+    fprintf(stderr, "STANZA_NURSERY_SIZE must not be larger than STANZA_HEAP_SIZE.\n");
+    exit(-1);
+  }
+
   //Allocate heap
-  const stz_long min_heap_size = ROUND_UP_TO_WHOLE_PAGES(8 * 1024 * 1024);
-  const stz_long max_heap_size = ROUND_UP_TO_WHOLE_PAGES(STZ_LONG(8) * 1024 * 1024 * 1024);
   init.heap_start = (stz_byte*)stz_memory_map(min_heap_size, max_heap_size);
   init.heap_max_size = max_heap_size;
   init.heap_size = min_heap_size;
-  stz_long young_gen_size = 2 * 1024 * 1024;
   init.heap_limit = init.heap_start + young_gen_size;
   init.heap_top = init.heap_start;
   init.heap_old_objects_end = init.heap_start;
@@ -1114,7 +1260,7 @@ STANZA_API_FUNC int main (int argc, char* argv[]) {
   }
 
   //Allocate marking stack for heap
-  const stz_long marking_stack_size = ROUND_UP_TO_WHOLE_PAGES((1024 * 1024L) << LOG_BYTES_IN_LONG);
+  const stz_long marking_stack_size = ROUND_UP_TO_WHOLE_PAGES(marking_stack_entries << LOG_BYTES_IN_LONG);
   init.marking_stack_start = stz_memory_map(marking_stack_size, marking_stack_size);
   init.marking_stack_bottom = init.marking_stack_start + marking_stack_size;
   init.marking_stack_top = init.marking_stack_bottom;
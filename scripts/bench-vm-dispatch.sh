@@ -0,0 +1,69 @@
+#!/usr/bin/env bash
+
+# Compares the threaded and the switch-based dispatch loops of the
+# bytecode interpreter (compiler/cvm.c). Links the given compiler
+# assembly against both variants of the VM and times `stanza run`
+# on the example programs with each of them.
+#
+# USAGES:
+# ./scripts/bench-vm-dispatch.sh lstanza.s linux
+# ./scripts/bench-vm-dispatch.sh stanza.s os-x 10
+
+set -e
+set -o pipefail
+
+if [ $# -lt 2 ]; then
+    echo "Not enough arguments"
+    exit 2
+fi
+
+STANZA_S="$1"
+PLATFORM="$2"
+RUNS="${3:-5}"
+
+case "$PLATFORM" in
+    linux) DPLATFORM="-DPLATFORM_LINUX" ; LIBS="-lm -ldl -fPIC" ;;
+    os-x)  DPLATFORM="-DPLATFORM_OS_X"  ; LIBS="-lm -mmacosx-version-min=10.13" ;;
+    *) cat 1>&2 <<EOM
+Error: unsupported/unrecognized platform: \`$PLATFORM\`
+Supported platforms: linux, os-x
+EOM
+       exit 2 ;;
+esac
+
+EXAMPLES="helloworld calculus closure dispatch sort string triforce wrapping-and-indenting"
+
+mkdir -p build
+
+#Link one compiler per dispatch mode.
+build_variant () {
+    local NAME="$1"
+    local FLAGS="$2"
+    gcc -std=gnu99 -c core/sha256.c -O3 -o build/sha256.o -fPIC -I include
+    gcc -std=gnu99 -c compiler/cvm.c -O3 -o build/cvm-$NAME.o -fPIC -I include $FLAGS
+    gcc -std=gnu99 runtime/driver.c runtime/linenoise.c build/cvm-$NAME.o build/sha256.o $STANZA_S \
+        -o build/stanza-$NAME $DPLATFORM $LIBS -I include
+}
+
+build_variant threaded ""
+build_variant switch "-D VM_SWITCH_DISPATCH"
+
+#Time RUNS executions of each example with the given compiler.
+time_variant () {
+    local NAME="$1"
+    local EXAMPLE="$2"
+    local START=$(date +%s.%N)
+    for ((i = 0; i < RUNS; i++)); do
+        ./build/stanza-$NAME run examples/$EXAMPLE.stanza > /dev/null
+    done
+    local END=$(date +%s.%N)
+    echo "($END - $START) / $RUNS" | bc -l
+}
+
+printf "%-26s %12s %12s %8s\n" "example" "switch (s)" "threaded (s)" "speedup"
+for EXAMPLE in $EXAMPLES; do
+    SWITCH=$(time_variant switch $EXAMPLE)
+    THREADED=$(time_variant threaded $EXAMPLE)
+    SPEEDUP=$(echo "$SWITCH / $THREADED" | bc -l)
+    printf "%-26s %12.3f %12.3f %7.2fx\n" $EXAMPLE $SWITCH $THREADED $SPEEDUP
+done
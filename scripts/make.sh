@@ -55,7 +55,7 @@ esac
 echo "Building Stanza for $DPLATFORM"
 
 #Pkg packages
-PKGFILES="math arg-parser line-wrap stz/test-driver stz/mocker stz/arg-parser"
+PKGFILES="math arg-parser line-wrap core/scheduler stz/test-driver stz/mocker stz/arg-parser"
 PKGDIR="${PLATFORM_PREFIX}pkgs"
 STANZA_S="${PLATFORM_PREFIX}stanza.s"
 
@@ -1,3 +1,7 @@
+# Runs the tests with the installed stanza compiler, which loads core
+# from this tree. When core declares new runtime externs, the VM of the
+# installed compiler cannot load it, so first rebuild and install the
+# compiler from this tree.
 stanza run-test build-stanza.proj tests/stanza.proj stz/stanza-tests
 stanza compile-test build-stanza.proj tests/stanza.proj stz/stanza-tests -o build/stanza-tests
 ./build/stanza-tests